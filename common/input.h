@@ -0,0 +1,395 @@
+#pragma once
+
+// Shared input handling for all days: the whole file is mapped read-only and walked
+// with string_views, numbers go through std::from_chars. Nothing is copied unless a
+// day decides to keep it.
+
+#include <algorithm>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace aoc {
+
+// Read-only mapping of a whole file, unmapped on destruction. A missing or empty file
+// gives an empty buffer, check is_open() to tell the two apart. The access hint goes to
+// madvise: the default suits the usual front to back parse, readers that jump around
+// or come from both ends should pass MADV_NORMAL or MADV_RANDOM.
+class InputBuffer {
+public:
+    InputBuffer() = default;
+
+    explicit InputBuffer(const std::filesystem::path &path, int advice = MADV_SEQUENTIAL) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if ( fd < 0 ) {
+            return;
+        }
+
+        opened = true;
+
+        struct stat st{};
+        if ( ::fstat(fd, &st) == 0 && st.st_size > 0 ) {
+            void *mapping = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if ( mapping != MAP_FAILED ) {
+                data = static_cast<const char *>(mapping);
+                size = static_cast<std::size_t>(st.st_size);
+
+                if ( advice != MADV_NORMAL ) {
+                    ::madvise(mapping, size, advice);
+                }
+            }
+        }
+
+        ::close(fd);
+    }
+
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer &operator=(const InputBuffer &) = delete;
+
+    InputBuffer(InputBuffer &&other) noexcept
+        : data(std::exchange(other.data, nullptr)),
+          size(std::exchange(other.size, 0)),
+          opened(std::exchange(other.opened, false))
+    {
+    }
+
+    InputBuffer &operator=(InputBuffer &&other) noexcept {
+        if ( this != &other ) {
+            unmap();
+            data = std::exchange(other.data, nullptr);
+            size = std::exchange(other.size, 0);
+            opened = std::exchange(other.opened, false);
+        }
+
+        return *this;
+    }
+
+    ~InputBuffer() {
+        unmap();
+    }
+
+    bool is_open() const {
+        return opened;
+    }
+
+    std::string_view view() const {
+        return {data, size};
+    }
+
+private:
+    void unmap() {
+        if ( data != nullptr ) {
+            ::munmap(const_cast<char *>(data), size);
+            data = nullptr;
+        }
+    }
+
+    const char *data = nullptr;
+    std::size_t size = 0;
+    bool opened = false;
+};
+
+// Open a file or complain and abort, for days that can't do anything without input
+inline InputBuffer open_input(const std::filesystem::path &path, int advice = MADV_SEQUENTIAL)
+{
+    InputBuffer buffer{path, advice};
+
+    if ( ! buffer.is_open() ) {
+        std::cerr << std::format("Couldn't open {}!\n", path.string());
+        std::abort();
+    }
+
+    return buffer;
+}
+
+inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Splits text into pieces separated by delim. With Collapse set, runs of whitespace
+// count as a single separator and empty pieces are skipped, which is what we want for
+// "1   2  3". Without it every delimiter counts, so "a||b" has an empty middle piece.
+// A trailing delimiter doesn't produce an empty last piece either way, so a file
+// ending in '\n' doesn't get an extra blank line.
+template <bool Collapse>
+class SplitRange {
+public:
+    class iterator {
+    public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator() = default;
+
+        iterator(std::string_view rest_, char delim_)
+            : rest(rest_), delim(delim_), done(false)
+        {
+            skip_blanks();
+            last = rest.empty();
+            advance();
+        }
+
+        std::string_view operator*() const {
+            return current;
+        }
+
+        iterator &operator++() {
+            advance();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto copy = *this;
+            advance();
+            return copy;
+        }
+
+        bool operator==(const iterator &other) const {
+            if ( done || other.done ) {
+                return done == other.done;
+            }
+            return current.data() == other.current.data();
+        }
+
+    private:
+        bool is_delim(char c) const {
+            return Collapse ? is_blank(c) : c == delim;
+        }
+
+        void skip_blanks() {
+            if constexpr ( Collapse ) {
+                while ( ! rest.empty() && is_blank(rest.front()) ) {
+                    rest.remove_prefix(1);
+                }
+            }
+        }
+
+        void advance() {
+            if ( last ) {
+                done = true;
+                return;
+            }
+
+            std::size_t end = 0;
+            while ( end < rest.size() && ! is_delim(rest[end]) ) {
+                end++;
+            }
+
+            current = rest.substr(0, end);
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+            skip_blanks();
+
+            // Also true right after a trailing delimiter
+            last = rest.empty();
+        }
+
+        std::string_view rest{};
+        std::string_view current{};
+        char delim = ' ';
+        bool done = true;
+        bool last = true;
+    };
+
+    SplitRange(std::string_view text_, char delim_)
+        : text(text_), delim(delim_)
+    {
+    }
+
+    iterator begin() const {
+        return {text, delim};
+    }
+
+    iterator end() const {
+        return {};
+    }
+
+private:
+    std::string_view text;
+    char delim;
+};
+
+// Every line without its '\n' (and '\r', if the input came from Windows). Blank lines
+// in the middle are kept since some days use them as section separators.
+class LineRange {
+public:
+    class iterator {
+    public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator() = default;
+
+        explicit iterator(SplitRange<false>::iterator inner_)
+            : inner(inner_)
+        {
+        }
+
+        std::string_view operator*() const {
+            std::string_view line = *inner;
+
+            if ( ! line.empty() && line.back() == '\r' ) {
+                line.remove_suffix(1);
+            }
+
+            return line;
+        }
+
+        iterator &operator++() {
+            ++inner;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto copy = *this;
+            ++inner;
+            return copy;
+        }
+
+        bool operator==(const iterator &other) const = default;
+
+    private:
+        SplitRange<false>::iterator inner{};
+    };
+
+    explicit LineRange(std::string_view text)
+        : lines(text, '\n')
+    {
+    }
+
+    iterator begin() const {
+        return iterator{lines.begin()};
+    }
+
+    iterator end() const {
+        return iterator{lines.end()};
+    }
+
+private:
+    SplitRange<false> lines;
+};
+
+inline LineRange lines(std::string_view text)
+{
+    return LineRange{text};
+}
+
+// Whitespace separated fields, runs of blanks count as one
+inline SplitRange<true> fields(std::string_view text)
+{
+    return {text, ' '};
+}
+
+// Fields separated by exactly one delim each, e.g. "1,2,3" or "47|53"
+inline SplitRange<false> fields(std::string_view text, char delim)
+{
+    return {text, delim};
+}
+
+// Parse all of text as an integer. A leading '+' is accepted for signed types, and so is
+// surrounding whitespace, anything else makes it fail.
+template <std::integral T>
+std::optional<T> parse_int(std::string_view text)
+{
+    while ( ! text.empty() && is_blank(text.front()) ) {
+        text.remove_prefix(1);
+    }
+
+    while ( ! text.empty() && is_blank(text.back()) ) {
+        text.remove_suffix(1);
+    }
+
+    if constexpr ( std::signed_integral<T> ) {
+        if ( text.size() > 1 && text.front() == '+' ) {
+            text.remove_prefix(1);
+        }
+    }
+
+    T value{};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if ( ec != std::errc{} || ptr != text.data() + text.size() || text.empty() ) {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+// Same as parse_int, but bad input is fatal
+template <std::integral T>
+T expect_int(std::string_view text)
+{
+    auto value = parse_int<T>(text);
+
+    if ( ! value ) {
+        std::cerr << std::format("Expected a number, got '{}'\n", text);
+        std::abort();
+    }
+
+    return *value;
+}
+
+// Parse the number at the front of text and drop it from the view, leaving whatever
+// follows (e.g. the ':' in "190: 10 19"). Leading blanks are skipped.
+template <std::integral T>
+std::optional<T> consume_int(std::string_view &text)
+{
+    while ( ! text.empty() && is_blank(text.front()) ) {
+        text.remove_prefix(1);
+    }
+
+    T value{};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if ( ec != std::errc{} ) {
+        return std::nullopt;
+    }
+
+    text.remove_prefix(static_cast<std::size_t>(ptr - text.data()));
+    return value;
+}
+
+// All whitespace separated integers in text
+template <std::integral T>
+std::vector<T> parse_ints(std::string_view text)
+{
+    std::vector<T> result{};
+
+    for ( auto field : fields(text) ) {
+        result.emplace_back(expect_int<T>(field));
+    }
+
+    return result;
+}
+
+// All delim separated integers in text, e.g. parse_ints<int>("75,47,61", ',')
+template <std::integral T>
+std::vector<T> parse_ints(std::string_view text, char delim)
+{
+    std::vector<T> result{};
+
+    for ( auto field : fields(text, delim) ) {
+        result.emplace_back(expect_int<T>(field));
+    }
+
+    return result;
+}
+
+} // namespace aoc
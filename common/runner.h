@@ -0,0 +1,51 @@
+#pragma once
+
+// Task registry for the unified runner. Every day registers its tasks from its own
+// translation unit when it's built with -DAOC_RUNNER, the runner then just walks the
+// list. Built standalone, a day ignores all of this and keeps its own main.
+
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace aoc {
+
+// Runs a task on an input file and hands back its answer as text
+using TaskFn = std::function<std::string(const std::filesystem::path &)>;
+
+struct Task {
+    int day;
+    std::string name;
+    TaskFn run;
+};
+
+// Function-local so registrations from other translation units can't run before it exists
+inline std::vector<Task> &task_registry()
+{
+    static std::vector<Task> tasks{};
+    return tasks;
+}
+
+struct RegisterTask {
+    RegisterTask(int day, std::string name, TaskFn run) {
+        task_registry().push_back(Task{day, std::move(name), std::move(run)});
+    }
+};
+
+template <class T>
+std::string answer(const T &value)
+{
+    return std::format("{}", value);
+}
+
+// Days that solve both parts in one go
+template <class A, class B>
+std::string answer(const std::pair<A, B> &value)
+{
+    return std::format("{} / {}", value.first, value.second);
+}
+
+} // namespace aoc
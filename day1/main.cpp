@@ -1,6 +1,6 @@
+#include <algorithm>
 #include <cstdlib>
 #include <execution>
-#include <fstream>
 #include <iostream>
 #include <numeric>
 #include <string>
@@ -8,25 +8,35 @@
 #include <format>
 #include <vector>
 
+#include "input.h"
+#include "runner.h"
+
+namespace day1 {
+
+// Two columns of numbers, left and right
+void read_lists(const aoc::InputBuffer &input, std::vector<int64_t> &left, std::vector<int64_t> &right)
+{
+    auto numbers = aoc::parse_ints<int64_t>(input.view());
+
+    for ( std::size_t i = 0; i + 1 < numbers.size(); i += 2 ) {
+        left.emplace_back(numbers[i]);
+        right.emplace_back(numbers[i + 1]);
+    }
+}
+
 int64_t task1( std::filesystem::path file ) {
 
-    std::fstream fs{file};
+    aoc::InputBuffer input{file};
 
-    if ( ! fs.is_open() )  {
+    if ( ! input.is_open() )  {
         std::cerr << std::format("Failed to open {}\n", file.string());
         return -1;
     }
 
-    int64_t a, b;
-
     std::vector<int64_t> left;
     std::vector<int64_t> right;
 
-
-    while ( fs >> a >> b ) {
-        left.emplace_back(a);
-        right.emplace_back(b);
-    }
+    read_lists(input, left, right);
 
     std::sort(std::begin(left), std::end(left));
     std::sort(std::begin(right), std::end(right));
@@ -41,25 +51,17 @@ int64_t task1( std::filesystem::path file ) {
 
 int64_t task2( std::filesystem::path file ) {
 
-    std::fstream fs{file};
+    aoc::InputBuffer input{file};
 
-    if ( ! fs.is_open() )  {
+    if ( ! input.is_open() )  {
         std::cerr << std::format("Failed to open {}\n", file.string());
         return -1;
     }
 
-    std::string line;
-
-    int64_t a, b;
-
     std::vector<int64_t> left;
     std::vector<int64_t> right;
 
-
-    while ( fs >> a >> b ) {
-        left.emplace_back(a);
-        right.emplace_back(b);
-    }
+    read_lists(input, left, right);
 
     return std::accumulate(std::begin(left), std::end(left),
                     int64_t{0}, [&right] ( int64_t acc, int64_t x ) {
@@ -67,6 +69,20 @@ int64_t task2( std::filesystem::path file ) {
                        });
 }
 
+} // namespace day1
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{1, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day1::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{1, "task2", [] (const std::filesystem::path &path) {
+    return aoc::answer(day1::task2(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -80,11 +96,13 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto result1 = task1(file_to_read);
-    auto result2 = task2(file_to_read);
+    auto result1 = day1::task1(file_to_read);
+    auto result2 = day1::task2(file_to_read);
 
     std::cout << std::format("Task 1: {}\n", result1);
     std::cout << std::format("Task 2: {}\n", result2);
 
     return 0;
 }
+
+#endif
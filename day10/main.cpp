@@ -1,13 +1,22 @@
+#include <array>
+#include <bit>
+#include <bitset>
 #include <cassert>
 #include <cstdlib>
-#include <fstream>
+#include <execution>
 #include <iostream>
 #include <filesystem>
 #include <format>
-#include <sstream>
+#include <iterator>
+#include <numeric>
+#include <optional>
 #include <algorithm>
 #include <vector>
-#include <unordered_map>
+
+#include "input.h"
+#include "runner.h"
+
+namespace day10 {
 
 struct Vec2
 {
@@ -23,28 +32,103 @@ struct Vec2
     }
 };
 
-struct Vec2Hash {
-    static std::size_t hash(Vec2 v) {
-        return static_cast<std::size_t>(v.x ^ (v.y << 4));
+// Set of summits reachable from a cell, as a fixed-size bitset while the map has few
+// summits
+struct SummitBits {
+    static constexpr std::size_t CAPACITY = 256;
+
+    std::bitset<CAPACITY> bits;
+
+    void insert(uint32_t summit) { bits.set(summit); }
+    void merge(const SummitBits &other) { bits |= other.bits; }
+    std::size_t size() const { return bits.count(); }
+};
+
+// ... and as a sorted list of summit IDs when there are many. Only summits within nine
+// steps can be reached, so the lists stay short however large the map gets.
+struct SummitList {
+    std::vector<uint32_t> ids;
+
+    void insert(uint32_t summit) { ids.push_back(summit); }
+
+    void merge(const SummitList &other) {
+        std::vector<uint32_t> merged{};
+        merged.reserve(ids.size() + other.ids.size());
+        std::set_union(std::begin(ids), std::end(ids), std::begin(other.ids), std::end(other.ids),
+                std::back_inserter(merged));
+        ids = std::move(merged);
     }
 
-    std::size_t operator()(Vec2 p) const {
-        return hash(p);
+    std::size_t size() const { return ids.size(); }
+};
+
+// Steps to the four neighbors, in the bit order of a cell's neighbor mask
+static constexpr std::array<Vec2, 4> DIRECTIONS{
+    Vec2{0,-1}, Vec2{0,1}, Vec2{-1,0}, Vec2{1,0}
+};
+
+// Height nibble of cells that can't be part of a trail
+static constexpr uint8_t NO_HEIGHT = 0x0F;
+
+// A trail never gets further than this from its trailhead
+static constexpr std::size_t MAX_TRAIL_LENGTH = 9;
+
+// Cells [x0, x1) x [y0, y1)
+struct Tile {
+    std::size_t x0, y0, x1, y1;
+
+    bool contains(std::size_t x, std::size_t y) const {
+        return x >= x0 && x < x1 && y >= y0 && y < y1;
+    }
+
+    // Grown by `margin` on every side, clamped to an nx * ny map
+    Tile expanded(std::size_t margin, std::size_t nx, std::size_t ny) const {
+        return Tile{
+            x0 > margin ? x0 - margin : 0,
+            y0 > margin ? y0 - margin : 0,
+            std::min(x1 + margin, nx),
+            std::min(y1 + margin, ny),
+        };
+    }
+};
+
+struct TrailTotals {
+    uint64_t score = 0;
+    uint64_t rating = 0;
+
+    TrailTotals operator+(const TrailTotals &other) const {
+        return TrailTotals{score + other.score, rating + other.rating};
+    }
+
+    TrailTotals operator-(const TrailTotals &other) const {
+        return TrailTotals{score - other.score, rating - other.rating};
     }
 };
 
 struct Map
 {
     int at(int64_t x, int64_t y) const {
-        return heights[static_cast<std::size_t>(y)*static_cast<std::size_t>(nx) + static_cast<std::size_t>(x)];
+        return cells[index(x, y)] & 0x0F;
     }
 
-    int & at(int64_t x, int64_t y) {
-        return heights[static_cast<std::size_t>(y)*static_cast<std::size_t>(nx) + static_cast<std::size_t>(x)];
+    // Directions (bits into DIRECTIONS) leading to a height+1 neighbor
+    uint8_t nexts_at(int64_t x, int64_t y) const {
+        return static_cast<uint8_t>(cells[index(x, y)] >> 4);
     }
 
-    const std::vector<Vec2> &nexts_at(int64_t x, int64_t y) const {
-        return nexts[static_cast<std::size_t>(y)*static_cast<std::size_t>(nx) + static_cast<std::size_t>(x)];
+    std::size_t index(int64_t x, int64_t y) const {
+        return static_cast<std::size_t>(y)*static_cast<std::size_t>(nx) + static_cast<std::size_t>(x);
+    }
+
+    // Calls fn with the flat index of every height+1 neighbor of cell idx
+    template <class Fn>
+    void for_each_next_index(std::size_t idx, Fn &&fn) const {
+        const unsigned mask = cells[idx] >> 4;
+
+        if ( mask & 0b0001 ) fn(idx - nx);
+        if ( mask & 0b0010 ) fn(idx + nx);
+        if ( mask & 0b0100 ) fn(idx - 1);
+        if ( mask & 0b1000 ) fn(idx + 1);
     }
 
 
@@ -53,9 +137,9 @@ struct Map
         for ( auto y = 0; y < ny; y++) {
             for ( auto x = 0; x < nx; x++)
             {
-                const std::size_t idx = std::size_t(x) + std::size_t(y) * nx;
-                if ( nexts[idx].size() > 0 ) {
-                    os << nexts[idx].size();
+                const int n_nexts = std::popcount(nexts_at(x, y));
+                if ( n_nexts > 0 ) {
+                    os << n_nexts;
                 } else {
                     os << ".";
                 }
@@ -64,104 +148,117 @@ struct Map
         }
     }
 
-    using PartialPath = std::pair<Vec2, std::vector<Vec2>>;
-
-    int64_t evaluate_trailhead(Vec2 pos) const
+    // Cell indices grouped by height, each group in scan order
+    std::array<std::vector<std::size_t>, 10> cells_by_height() const
     {
+        std::array<std::vector<std::size_t>, 10> layers{};
 
-        std::vector<PartialPath> stack;
-        std::unordered_map<Vec2, bool, Vec2Hash> visited{};
-
-        stack.emplace_back(std::make_pair(pos, std::vector<Vec2>{}));
-
-        std::vector<PartialPath> resultingPaths{};
-
-        while ( ! stack.empty() ) {
+        for ( std::size_t idx = 0; idx < cells.size(); idx++ ) {
+            const std::size_t height = cells[idx] & 0x0F;
 
-            auto [current_pos, current_path] = std::move(stack.back());
-            stack.pop_back();
-
-            // The popped position is not inside the map
-            if ( ! isInside(current_pos.x, current_pos.y) ) {
-                continue;
+            if ( height <= 9 ) {
+                layers[height].push_back(idx);
             }
+        }
 
-            if ( visited[current_pos] ) {
-                continue;
-            }
+        return layers;
+    }
 
-            auto val = at(current_pos.x, current_pos.y );
+    // Walks the layers from height 9 down to 0. Every cell gets the union of the summit
+    // sets of its height+1 neighbors, so a trailhead's score is the size of its set.
+    template <class SummitSet>
+    std::vector<uint64_t> propagate_summits() const
+    {
+        auto layers = cells_by_height();
 
-            if ( val == 9 ) {
-                resultingPaths.push_back(PartialPath{current_pos, current_path});
+        // Position of each cell within its own layer
+        std::vector<uint32_t> slot(cells.size(), 0);
+        for ( auto &layer : layers ) {
+            for ( std::size_t i = 0; i < layer.size(); i++ ) {
+                slot[layer[i]] = static_cast<uint32_t>(i);
             }
+        }
 
-            visited[current_pos] = true;
+        std::vector<SummitSet> upper(layers[9].size());
+        for ( std::size_t i = 0; i < upper.size(); i++ ) {
+            upper[i].insert(static_cast<uint32_t>(i));
+        }
 
-            auto &point_nexts = nexts_at(current_pos.x, current_pos.y);
+        for ( std::size_t h = 9; h-- > 0; ) {
+            std::vector<SummitSet> lower(layers[h].size());
 
-            for ( auto &pt : point_nexts ) {
-                // Current partial path
-                std::vector<Vec2> new_partial_path = current_path;
-                new_partial_path.emplace_back(current_pos);
-                stack.emplace_back(std::make_pair(pt, new_partial_path));
+            for ( std::size_t i = 0; i < layers[h].size(); i++ ) {
+                for_each_next_index(layers[h][i], [&] (std::size_t next_idx) {
+                    lower[i].merge(upper[slot[next_idx]]);
+                });
             }
+
+            upper = std::move(lower);
         }
 
-        return int64_t(resultingPaths.size());
+        std::vector<uint64_t> scores(upper.size());
+        std::transform(std::begin(upper), std::end(upper), std::begin(scores), [] (const SummitSet &set) {
+            return static_cast<uint64_t>(set.size());
+        });
+
+        return scores;
     }
 
-    int64_t evaluate_trailhead_rating(Vec2 pos) const
+    // Score of every trailhead, in find_trailheads() order
+    std::vector<uint64_t> trailhead_scores() const
     {
+        const auto n_summits = static_cast<std::size_t>(std::count_if(std::begin(cells), std::end(cells), [] (uint8_t cell) {
+            return (cell & 0x0F) == 9;
+        }));
 
-        std::vector<PartialPath> stack;
-        // std::unordered_map<Vec2, bool, Vec2Hash> visited{};
-
-        stack.emplace_back(std::make_pair(pos, std::vector<Vec2>{}));
-
-        std::vector<PartialPath> resultingPaths{};
-
-        while ( ! stack.empty() ) {
-
-            auto [current_pos, current_path] = std::move(stack.back());
-            stack.pop_back();
+        if ( n_summits <= SummitBits::CAPACITY ) {
+            return propagate_summits<SummitBits>();
+        }
 
-            // The popped position is not inside the map
-            if ( ! isInside(current_pos.x, current_pos.y) ) {
-                continue;
-            }
+        return propagate_summits<SummitList>();
+    }
 
-            auto val = at(current_pos.x, current_pos.y );
+    // Rating of every trailhead, in find_trailheads() order. The number of trails from a
+    // cell is 1 at a summit and otherwise the sum over its height+1 neighbors, so one
+    // pass over the layers from the top counts all paths without enumerating them.
+    std::vector<uint64_t> trailhead_ratings() const
+    {
+        auto layers = cells_by_height();
 
-            if ( val == 9 ) {
-                resultingPaths.push_back(PartialPath{current_pos, current_path});
-            }
+        std::vector<uint64_t> paths(cells.size(), 0);
 
-            auto &point_nexts = nexts_at(current_pos.x, current_pos.y);
+        for ( auto idx : layers[9] ) {
+            paths[idx] = 1;
+        }
 
-            for ( auto &pt : point_nexts ) {
-                // Current partial path
-                std::vector<Vec2> new_partial_path = current_path;
-                new_partial_path.emplace_back(current_pos);
-                stack.emplace_back(std::make_pair(pt, new_partial_path));
+        for ( std::size_t h = 9; h-- > 0; ) {
+            for ( auto idx : layers[h] ) {
+                for_each_next_index(idx, [&paths, idx] (std::size_t next_idx) {
+                    paths[idx] += paths[next_idx];
+                });
             }
         }
 
-        return int64_t(resultingPaths.size());
+        std::vector<uint64_t> ratings(layers[0].size());
+        std::transform(std::begin(layers[0]), std::end(layers[0]), std::begin(ratings), [&paths] (std::size_t idx) {
+            return paths[idx];
+        });
+
+        return ratings;
     }
 
     std::vector<Vec2> find_trailheads() const
     {
         std::vector<Vec2> trailheads{};
 
-        for ( auto it = std::begin(heights); it != std::end(heights); it++ )
+        for ( auto it = std::begin(cells); it != std::end(cells); it++ )
         {
-            auto idx = std::distance(std::begin(heights), it);
+            auto idx = std::distance(std::begin(cells), it);
 
             auto y = idx / int64_t(nx);
             auto x = idx % int64_t(nx);
 
-            if ( *it == 0 ) {
+            if ( (*it & 0x0F) == 0 ) {
                 trailheads.emplace_back(Vec2{x,y});
             }
         }
@@ -169,115 +266,251 @@ struct Map
         return trailheads;
     }
 
-    std::vector<Vec2> populate_next_at(Vec2 pos) {
+    // Neighbor masks of one row, from the heights of that row and the rows around it.
+    // Each direction is a separate branch-free compare over the whole row, which the
+    // compiler turns into SIMD byte compares.
+    static void row_masks(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+            uint8_t *out, std::size_t nx)
+    {
+        for ( std::size_t x = 0; x < nx; x++ ) {
+            out[x] = row[x];
+        }
 
-        std::vector<Vec2> result{};
+        if ( above != nullptr ) {
+            for ( std::size_t x = 0; x < nx; x++ ) {
+                out[x] |= static_cast<uint8_t>((above[x] == row[x] + 1) << 4);
+            }
+        }
 
-        if ( ! isInside(pos.x, pos.y) ) {
-            return {};
+        if ( below != nullptr ) {
+            for ( std::size_t x = 0; x < nx; x++ ) {
+                out[x] |= static_cast<uint8_t>((below[x] == row[x] + 1) << 5);
+            }
+        }
+
+        for ( std::size_t x = 1; x < nx; x++ ) {
+            out[x] |= static_cast<uint8_t>((row[x - 1] == row[x] + 1) << 6);
         }
 
-        auto val = at(pos.x, pos.y);
+        for ( std::size_t x = 0; x + 1 < nx; x++ ) {
+            out[x] |= static_cast<uint8_t>((row[x + 1] == row[x] + 1) << 7);
+        }
+    }
 
+    // Packs heights and neighbor masks into cells, rows in parallel
+    void populate_nexts(const std::vector<uint8_t> &heights) {
 
-        static constexpr std::array<Vec2, 4> directions{
-            Vec2{0,-1}, Vec2{0,1}, Vec2{-1,0}, Vec2{1,0}
-        };
+        cells.resize(heights.size());
 
-        for ( auto &dir : directions ) {
-            Vec2 next = pos + dir;
+        std::vector<std::size_t> rows(ny);
+        std::iota(std::begin(rows), std::end(rows), std::size_t{0});
 
-            if ( isInside(next.x, next.y ) ) {
-                if ( at(next.x, next.y) == val + 1 ) {
-                    result.emplace_back(next);
-                }
+        std::for_each(std::execution::par, std::begin(rows), std::end(rows), [this, &heights] (std::size_t y) {
+            const uint8_t *row = heights.data() + y * nx;
+
+            row_masks(y > 0 ? row - nx : nullptr, row, y + 1 < ny ? row + nx : nullptr,
+                    cells.data() + y * nx, nx);
+        });
+    }
+
+
+    bool isInside(int64_t x, int64_t y) const {
+        return x >= 0 && x < static_cast<int64_t>(nx)
+            && y >= 0 && y < static_cast<int64_t>(ny);
+    }
+
+    // The cells inside `window` as a map of their own. Neighbor masks are rebuilt, so
+    // they never point out of the window.
+    Map sub_map(const Tile &window) const
+    {
+        const std::size_t w = window.x1 - window.x0;
+        const std::size_t h = window.y1 - window.y0;
+
+        std::vector<uint8_t> heights(w * h);
+
+        for ( std::size_t y = 0; y < h; y++ ) {
+            const uint8_t *row = cells.data() + (window.y0 + y) * nx + window.x0;
+
+            std::transform(row, row + w, std::begin(heights) + static_cast<std::ptrdiff_t>(y * w), [] (uint8_t cell) {
+                return static_cast<uint8_t>(cell & 0x0F);
+            });
+        }
+
+        return Map(heights, w, h);
+    }
+
+    // Score and rating totals of the trailheads inside `inner`. Every trail starting
+    // there stays within MAX_TRAIL_LENGTH cells, so a halo of that width around the
+    // tile is all the terrain the engines need to see.
+    TrailTotals evaluate_tile(const Tile &inner) const
+    {
+        const Tile halo = inner.expanded(MAX_TRAIL_LENGTH, nx, ny);
+        const Map local = sub_map(halo);
+
+        const auto trailheads = local.find_trailheads();
+        const auto scores = local.trailhead_scores();
+        const auto ratings = local.trailhead_ratings();
+
+        TrailTotals totals{};
+
+        for ( std::size_t i = 0; i < trailheads.size(); i++ ) {
+            const auto x = halo.x0 + static_cast<std::size_t>(trailheads[i].x);
+            const auto y = halo.y0 + static_cast<std::size_t>(trailheads[i].y);
+
+            if ( inner.contains(x, y) ) {
+                totals.score += scores[i];
+                totals.rating += ratings[i];
             }
         }
 
-        return result;
+        return totals;
     }
 
-    void populate_nexts() {
+    // Splits the map into tile_size * tile_size tiles, evaluates them in parallel and
+    // sums up the results
+    TrailTotals evaluate_parallel(std::size_t tile_size = 256) const
+    {
+        std::vector<Tile> tiles{};
 
-        nexts.resize(heights.size());
+        for ( std::size_t y = 0; y < ny; y += tile_size ) {
+            for ( std::size_t x = 0; x < nx; x += tile_size ) {
+                tiles.emplace_back(Tile{x, y, std::min(x + tile_size, nx), std::min(y + tile_size, ny)});
+            }
+        }
 
-        for ( auto i = 0; i < heights.size(); i++ )
-        {
-            std::vector<Vec2> point_nexts{};
+        return std::transform_reduce(std::execution::par, std::begin(tiles), std::end(tiles), TrailTotals{},
+                std::plus<>{}, [this] (const Tile &tile) {
+                    return evaluate_tile(tile);
+                });
+    }
 
-            auto y = i / int64_t(nx);
-            auto x = i % int64_t(nx);
+    // Score and rating totals of the whole map. Computed on first use, then kept
+    // current by set_height.
+    TrailTotals totals()
+    {
+        if ( ! tracked_totals ) {
+            tracked_totals = evaluate_parallel();
+        }
+
+        return *tracked_totals;
+    }
+
+    // Changes the height of one cell. Only the neighbor masks of the cell and the cells
+    // around it are rebuilt. Trailheads further than MAX_TRAIL_LENGTH away can't
+    // reach the cell, so the totals are patched by evaluating just that cone before
+    // and after the change.
+    void set_height(int64_t x, int64_t y, uint8_t height)
+    {
+        assert(isInside(x, y) && "Cell outside map");
+        assert((height <= 9 || height == NO_HEIGHT) && "Invalid height");
+
+        const auto ux = static_cast<std::size_t>(x);
+        const auto uy = static_cast<std::size_t>(y);
+        const Tile cone = Tile{ux, uy, ux + 1, uy + 1}.expanded(MAX_TRAIL_LENGTH, nx, ny);
 
-            nexts[size_t(y) * nx + size_t(x)] = populate_next_at(Vec2{x,y});
+        TrailTotals before{};
+        if ( tracked_totals ) {
+            before = evaluate_tile(cone);
+        }
+
+        cells[index(x, y)] = height;
+
+        refresh_mask(Vec2{x, y});
+        for ( auto &dir : DIRECTIONS ) {
+            Vec2 pos{x, y};
+            refresh_mask(pos + dir);
+        }
+
+        if ( tracked_totals ) {
+            *tracked_totals = *tracked_totals - before + evaluate_tile(cone);
         }
     }
 
+    // Rebuilds the neighbor mask of a single cell
+    void refresh_mask(Vec2 pos)
+    {
+        if ( ! isInside(pos.x, pos.y) ) {
+            return;
+        }
 
-    bool isInside(int64_t x, int64_t y) const {
-        return x >= 0 && x < static_cast<int>(nx)
-            && y >= 0 && y < static_cast<int>(ny);
+        const int height = at(pos.x, pos.y);
+        unsigned mask = 0;
+
+        for ( std::size_t d = 0; d < DIRECTIONS.size(); d++ ) {
+            Vec2 next = pos + DIRECTIONS[d];
+
+            if ( isInside(next.x, next.y) && at(next.x, next.y) == height + 1 ) {
+                mask |= 1u << d;
+            }
+        }
+
+        cells[index(pos.x, pos.y)] = static_cast<uint8_t>(static_cast<unsigned>(height) | (mask << 4));
     }
 
-    Map(std::vector<int> && heights_, std::size_t nx_, std::size_t ny_)
-        : heights{std::move(heights_)}, nx{nx_}, ny{ny_}
+    Map(const std::vector<uint8_t> &heights, std::size_t nx_, std::size_t ny_)
+        : nx{nx_}, ny{ny_}
     {
-        populate_nexts();
+        populate_nexts(heights);
     }
 
 private:
-    std::vector<int> heights;
-
-    std::vector<std::vector<Vec2>> nexts;
+    // Height in the low nibble, neighbor mask in the high nibble
+    std::vector<uint8_t> cells;
 
     std::size_t nx;
-    [[maybe_unused]] std::size_t ny;
+    std::size_t ny;
+
+    std::optional<TrailTotals> tracked_totals;
 };
 
 
-Map read_map(std::ifstream &fh) {
-    std::vector<int> heights{};
-    std::string current_line{};
+Map read_map(const aoc::InputBuffer &input) {
+    std::vector<uint8_t> heights{};
 
     std::size_t ny = 0, nx = 0;
 
-    while ( std::getline(fh, current_line) ) {
+    for ( auto current_line : aoc::lines(input.view()) ) {
         ny++;
         std::size_t cnx{0};
 
-        std::istringstream ss{current_line};
-        char c;
+        for ( char c : current_line ) {
+            if ( aoc::is_blank(c) ) {
+                continue;
+            }
 
-        while ( ss >> c ) {
             cnx++;
-            heights.emplace_back(c - '0');
+            heights.emplace_back(c >= '0' && c <= '9' ? static_cast<uint8_t>(c - '0') : NO_HEIGHT);
         }
 
         nx = std::max(cnx, nx);
     }
 
-    return Map(std::move(heights), nx, ny);
+    return Map(heights, nx, ny);
 }
 
-uint64_t task1(std::filesystem::path path)
+std::pair<uint64_t, uint64_t> task1(std::filesystem::path path)
 {
-    std::ifstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Couldn't open {}!\n", path.string());
     }
 
-    Map map = read_map(fh);
-    auto trailheads = map.find_trailheads();
+    Map map = read_map(input);
+    auto totals = map.evaluate_parallel();
 
-    auto sum = 0;
-    for ( auto trailhead : trailheads ) {
-        sum += map.evaluate_trailhead_rating(trailhead);
-    }
+    return std::make_pair(totals.score, totals.rating);
+}
 
-    map.print(std::cout);
+} // namespace day10
 
-    return std::size_t(sum);
-}
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{10, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day10::task1(path));
+}};
+
+#else
 
 int main(int argc, char *argv[])
 {
@@ -292,9 +525,12 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
+    auto [t1, t2] = day10::task1(file_to_read);
 
-    std::cout << std::format("Result: {}\n", t1);
+    std::cout << std::format("Task 1: {}\n", t1);
+    std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
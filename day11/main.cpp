@@ -1,135 +1,778 @@
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cstdlib>
-#include <fstream>
+#include <execution>
 #include <iostream>
 #include <filesystem>
 #include <format>
+#include <limits>
+#include <mutex>
 #include <numeric>
-#include <sstream>
+#include <optional>
+#include <thread>
 #include <algorithm>
 #include <vector>
 #include <unordered_map>
 
+#include "input.h"
+#include "runner.h"
+
+namespace day11 {
+
 constexpr std::size_t NUM_BLINKS = 75;
 
+// 10^0 through 10^19, every power of ten that fits in 64 bits
+static constexpr auto POWERS_OF_TEN = [] {
+    std::array<uint64_t, 20> powers{};
+    powers[0] = 1;
 
-std::vector<uint64_t> blink(std::vector<uint64_t> &&stones) {
-    std::vector<uint64_t> result{};
+    for ( std::size_t i = 1; i < powers.size(); i++ ) {
+        powers[i] = powers[i - 1] * 10;
+    }
 
-    for ( auto stone : stones ) {
-        std::string string_repr = std::to_string(stone);
-        std::size_t string_repr_len = string_repr.size();
+    return powers;
+}();
 
-        if ( stone == 0 ) {
-            result.emplace_back(1ULL);
-        } else if ( string_repr_len % 2 == 0 ) {
-            std::string left = string_repr.substr(0, string_repr_len/2);
-            std::string right = string_repr.substr(string_repr_len/2);
+constexpr std::size_t digit_count(uint64_t n)
+{
+    // log10(n) ~= log2(n) * 1233 / 4096, which is never too high and at most one too low
+    const std::size_t estimate = (static_cast<std::size_t>(std::bit_width(n)) * 1233) >> 12;
+    return estimate + (n >= POWERS_OF_TEN[estimate] ? 1 : 0);
+}
 
-            result.emplace_back(std::stoull(left));
-            result.emplace_back(std::stoull(right));
+// Left and right half of the decimal digits of n, which has `digits` digits
+constexpr std::pair<uint64_t, uint64_t> split_digits(uint64_t n, std::size_t digits)
+{
+    const uint64_t divisor = POWERS_OF_TEN[digits / 2];
+    return std::make_pair(n / divisor, n % divisor);
+}
+
+
+// Fixed-size cache of (stone, blinks left) -> stone count, shared between threads.
+// Slots are grouped in buckets of four under striped locks. A full bucket evicts the
+// entry with the fewest blinks left, which is the cheapest one to recompute.
+class BlinkCache {
+public:
+    explicit BlinkCache(std::size_t min_entries = 1 << 20)
+        : buckets(std::bit_ceil(std::max<std::size_t>(min_entries / BUCKET_SIZE, 2))),
+          shift(64 - static_cast<unsigned>(std::countr_zero(buckets.size())))
+    { }
+
+    std::optional<uint64_t> find(uint64_t stone, std::size_t blinks)
+    {
+        const std::size_t b = bucket_of(stone, blinks);
+        std::lock_guard lock{locks[b % locks.size()]};
+
+        for ( auto &entry : buckets[b] ) {
+            if ( entry.blinks == blinks && entry.stone == stone ) {
+                return entry.count;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    void insert(uint64_t stone, std::size_t blinks, uint64_t count)
+    {
+        const std::size_t b = bucket_of(stone, blinks);
+        std::lock_guard lock{locks[b % locks.size()]};
+
+        // Empty entries have zero blinks left, so they are evicted first
+        auto victim = std::min_element(std::begin(buckets[b]), std::end(buckets[b]), [] (const Entry &lhs, const Entry &rhs) {
+            return lhs.blinks < rhs.blinks;
+        });
+
+        *victim = Entry{stone, blinks, count};
+    }
+
+private:
+    static constexpr std::size_t BUCKET_SIZE = 4;
+
+    struct Entry {
+        uint64_t stone = 0;
+        std::size_t blinks = 0;
+        uint64_t count = 0;
+    };
+
+    std::size_t bucket_of(uint64_t stone, std::size_t blinks) const
+    {
+        // Fibonacci hashing, the top bits of the product pick the bucket
+        const uint64_t key = stone * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(blinks);
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+    std::vector<std::array<Entry, BUCKET_SIZE>> buckets;
+    unsigned shift;
+    std::array<std::mutex, 256> locks;
+};
+
+// Number of stones a single stone turns into after `blinks` blinks. Counts wrap
+// modulo 2^64 for very long horizons. This is a depth-first expansion like the plain
+// recursion, but with an explicit stack on the heap, so any horizon is fine. Child
+// counts are handed back through `result` rather than the cache, since the cache may
+// already have evicted them.
+uint64_t count_stones(uint64_t stone, std::size_t blinks, BlinkCache &cache)
+{
+    struct Frame {
+        uint64_t stone;
+        std::size_t blinks;
+        uint64_t count = 0;
+        std::size_t next_child = 0;
+    };
+
+    std::vector<Frame> stack{};
+    uint64_t result = 0;
+
+    // Either answers right away into result, or pushes a frame to expand
+    auto enter = [&stack, &result, &cache] (uint64_t s, std::size_t b) {
+        if ( b == 0 ) {
+            result = 1;
+            return true;
+        }
+
+        if ( auto cached = cache.find(s, b) ) {
+            result = *cached;
+            return true;
+        }
 
+        stack.push_back(Frame{s, b});
+        return false;
+    };
+
+    if ( enter(stone, blinks) ) {
+        return result;
+    }
+
+    while ( ! stack.empty() ) {
+        Frame &frame = stack.back();
+
+        std::array<uint64_t, 2> children{};
+        std::size_t n_children = 1;
+        std::size_t digits = digit_count(frame.stone);
+
+        if ( frame.stone == 0 ) {
+            children[0] = 1;
+        } else if ( digits % 2 == 0 ) {
+            auto [left, right] = split_digits(frame.stone, digits);
+            children = {left, right};
+            n_children = 2;
         } else {
-            result.emplace_back(stone * 2024);
+            children[0] = frame.stone * 2024;
+        }
+
+        if ( frame.next_child < n_children ) {
+            // frame may dangle after a push, so only touch it when nothing was pushed
+            if ( enter(children[frame.next_child++], frame.blinks - 1) ) {
+                frame.count += result;
+            }
+            continue;
+        }
+
+        cache.insert(frame.stone, frame.blinks, frame.count);
+        result = frame.count;
+        stack.pop_back();
+
+        if ( ! stack.empty() ) {
+            stack.back().count += result;
         }
     }
 
     return result;
 }
 
-uint64_t task1(std::filesystem::path path)
+std::vector<uint64_t> read_stones(std::filesystem::path path)
 {
-    std::ifstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Couldn't open {}!\n", path.string());
     }
 
-    std::vector<uint64_t> stones{};
+    return aoc::parse_ints<uint64_t>(input.view());
+}
+
+uint64_t task1(std::filesystem::path path, std::size_t blinks = NUM_BLINKS)
+{
+    std::vector<uint64_t> stones = read_stones(path);
+
+    // The initial stones are expanded in parallel, all through the same cache
+    BlinkCache cache{};
 
-    uint64_t input_num{0};
+    return std::transform_reduce(std::execution::par, std::begin(stones), std::end(stones), uint64_t{0},
+            std::plus<>{}, [&cache, blinks] (uint64_t stone) {
+                return count_stones(stone, blinks, cache);
+            });
+}
 
-    while ( fh >> input_num ) {
-        stones.emplace_back(input_num);
+// Flat stone -> count table with open addressing and linear probing. It is sized once
+// and cleared in place, so blinking doesn't allocate once the histogram has settled.
+// Iteration walks the slot arrays front to back.
+class StoneHistogram {
+public:
+    explicit StoneHistogram(std::size_t min_capacity = 1 << 13)
+    {
+        allocate(std::bit_ceil(std::max<std::size_t>(min_capacity, 16)));
     }
 
-    fh.close();
+    void add(uint64_t stone, uint64_t amount)
+    {
+        assert(stone != EMPTY && "Stone value reserved for empty slots");
 
-    for ( auto i = 0; i < NUM_BLINKS; i++ ) {
-        stones = blink(std::move(stones));
+        // Keep the load factor at or below one half
+        if ( 2 * (n_stones + 1) > keys.size() ) {
+            grow();
+        }
+
+        std::size_t slot = find_slot(stone);
+
+        if ( keys[slot] == EMPTY ) {
+            keys[slot] = stone;
+            n_stones++;
+        }
+
+        counts[slot] += amount;
     }
 
-    return stones.size();
-}
+    void clear()
+    {
+        std::fill(std::begin(keys), std::end(keys), EMPTY);
+        std::fill(std::begin(counts), std::end(counts), 0);
+        n_stones = 0;
+    }
 
-std::unordered_map<uint64_t, uint64_t> blink_fast(std::unordered_map<uint64_t, uint64_t> &&stones)
-{
-    std::unordered_map<uint64_t, uint64_t> result{};
+    template <class Fn>
+    void for_each(Fn &&fn) const
+    {
+        for ( std::size_t slot = 0; slot < keys.size(); slot++ ) {
+            if ( keys[slot] != EMPTY ) {
+                fn(keys[slot], counts[slot]);
+            }
+        }
+    }
 
+    std::size_t size() const { return n_stones; }
 
-    for ( auto [stone, amt] : stones ) {
+    uint64_t total() const
+    {
+        return std::accumulate(std::begin(counts), std::end(counts), uint64_t{0});
+    }
 
-        std::string string_repr = std::to_string(stone);
-        std::size_t string_repr_len = string_repr.size();
+private:
+    static constexpr uint64_t EMPTY = std::numeric_limits<uint64_t>::max();
 
-        if ( stone == 0 ) {
-            result[1] += amt;
-        } else if ( string_repr_len % 2 == 0 ) {
-            std::string left = string_repr.substr(0, string_repr_len/2);
-            std::string right = string_repr.substr(string_repr_len/2);
+    void allocate(std::size_t capacity)
+    {
+        keys.assign(capacity, EMPTY);
+        counts.assign(capacity, 0);
+        shift = 64 - static_cast<unsigned>(std::countr_zero(capacity));
+        n_stones = 0;
+    }
 
-            uint64_t l = std::stoull(left);
-            uint64_t r = std::stoull(right);
+    std::size_t find_slot(uint64_t stone) const
+    {
+        // Fibonacci hashing, the top bits of the product pick the home slot
+        std::size_t slot = static_cast<std::size_t>((stone * 0x9E3779B97F4A7C15ULL) >> shift);
+        const std::size_t mask = keys.size() - 1;
 
-            result[l] += amt;
-            result[r] += amt;
-        } else {
-            result[stone * 2024] += amt;
+        while ( keys[slot] != EMPTY && keys[slot] != stone ) {
+            slot = (slot + 1) & mask;
         }
+
+        return slot;
     }
 
-    return result;
+    void grow()
+    {
+        auto old_keys = std::move(keys);
+        auto old_counts = std::move(counts);
+
+        allocate(old_keys.size() * 2);
+
+        for ( std::size_t slot = 0; slot < old_keys.size(); slot++ ) {
+            if ( old_keys[slot] != EMPTY ) {
+                const std::size_t new_slot = find_slot(old_keys[slot]);
+                keys[new_slot] = old_keys[slot];
+                counts[new_slot] = old_counts[slot];
+                n_stones++;
+            }
+        }
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> counts;
+    unsigned shift = 0;
+    std::size_t n_stones = 0;
+};
+
+// Blinks every stone in `stones` and hands the resulting (stone, count) pairs to emit
+template <class Emit>
+void blink_stones(const StoneHistogram &stones, Emit &&emit)
+{
+    stones.for_each([&emit] (uint64_t stone, uint64_t amt) {
+
+        std::size_t digits = digit_count(stone);
+
+        if ( stone == 0 ) {
+            emit(1, amt);
+        } else if ( digits % 2 == 0 ) {
+            auto [l, r] = split_digits(stone, digits);
+
+            emit(l, amt);
+            emit(r, amt);
+        } else {
+            emit(stone * 2024, amt);
+        }
+    });
 }
 
-uint64_t task2(std::filesystem::path path)
+// One blink from `stones` into `result`, which is cleared first
+void blink_fast(const StoneHistogram &stones, StoneHistogram &result)
 {
-    std::ifstream fh{path};
+    result.clear();
 
-    if ( ! fh.is_open() ) {
-        std::cerr << std::format("Couldn't open {}!\n", path.string());
-    }
+    blink_stones(stones, [&result] (uint64_t stone, uint64_t amt) {
+        result.add(stone, amt);
+    });
+}
+
+std::size_t shard_of(uint64_t stone, std::size_t n_shards)
+{
+    return static_cast<std::size_t>(((stone * 0x9E3779B97F4A7C15ULL) >> 32) % n_shards);
+}
 
-    std::vector<uint64_t> stones{};
+// A histogram split into shards by key hash, plus the per-worker buckets used while
+// blinking it
+struct ShardedHistogram {
+    std::vector<StoneHistogram> shards;
 
-    uint64_t input_num{0};
+    // outboxes[w][d] holds what worker w produced for shard d
+    std::vector<std::vector<StoneHistogram>> outboxes;
 
-    while ( fh >> input_num ) {
-        stones.emplace_back(input_num);
+    explicit ShardedHistogram(std::size_t n_shards)
+        : shards(n_shards),
+          outboxes(n_shards, std::vector<StoneHistogram>(n_shards, StoneHistogram{64}))
+    { }
+
+    void add(uint64_t stone, uint64_t amount)
+    {
+        shards[shard_of(stone, shards.size())].add(stone, amount);
+    }
+
+    uint64_t total() const
+    {
+        return std::transform_reduce(std::begin(shards), std::end(shards), uint64_t{0}, std::plus<>{},
+                [] (const StoneHistogram &shard) {
+                    return shard.total();
+                });
     }
+};
+
+// One blink with one worker per shard. Worker w blinks shard w into its own row of
+// outboxes, then worker d merges column d into shard d. No table is written by two
+// workers, so neither phase needs locks.
+void blink_sharded(ShardedHistogram &stones)
+{
+    const std::size_t n_shards = stones.shards.size();
+
+    std::vector<std::size_t> workers(n_shards);
+    std::iota(std::begin(workers), std::end(workers), std::size_t{0});
+
+    std::for_each(std::execution::par, std::begin(workers), std::end(workers), [&stones, n_shards] (std::size_t w) {
+        auto &outbox = stones.outboxes[w];
+
+        for ( auto &bucket : outbox ) {
+            bucket.clear();
+        }
+
+        blink_stones(stones.shards[w], [&outbox, n_shards] (uint64_t stone, uint64_t amt) {
+            outbox[shard_of(stone, n_shards)].add(stone, amt);
+        });
+    });
+
+    std::for_each(std::execution::par, std::begin(workers), std::end(workers), [&stones] (std::size_t d) {
+        auto &shard = stones.shards[d];
+        shard.clear();
+
+        for ( auto &outbox : stones.outboxes ) {
+            outbox[d].for_each([&shard] (uint64_t stone, uint64_t amt) {
+                shard.add(stone, amt);
+            });
+        }
+    });
+}
 
-    fh.close();
+uint64_t task2(std::filesystem::path path)
+{
+    std::vector<uint64_t> stones = read_stones(path);
 
-    std::unordered_map<uint64_t, uint64_t> stones_map{};
+    // Two tables that swap roles every blink
+    StoneHistogram stones_map{};
+    StoneHistogram next_map{};
 
     for ( auto stone : stones ) {
-        // Zero-initialization?
-        stones_map[stone]++;
+        stones_map.add(stone, 1);
     }
 
     for ( auto i = 0; i < NUM_BLINKS; i++ ) {
-        stones_map = blink_fast(std::move(stones_map));
+        blink_fast(stones_map, next_map);
+        std::swap(stones_map, next_map);
     }
 
     // Sum up
-    return std::transform_reduce(std::begin(stones_map), std::end(stones_map), 0ULL,
-            std::plus<>(), [] ( auto p ) {
-                return p.second;
-            });
+    return stones_map.total();
 
 
     // return 0;
 }
 
+// task2 with every blink spread over n_shards workers
+uint64_t task2_sharded(std::filesystem::path path, std::size_t n_shards, std::size_t blinks = NUM_BLINKS)
+{
+    ShardedHistogram stones{std::max<std::size_t>(n_shards, 1)};
+
+    for ( auto stone : read_stones(path) ) {
+        stones.add(stone, 1);
+    }
+
+    for ( std::size_t i = 0; i < blinks; i++ ) {
+        blink_sharded(stones);
+    }
+
+    return stones.total();
+}
+
+// Counts in the transition engine are taken modulo this Mersenne prime
+static constexpr uint64_t BLINK_MODULUS = (1ULL << 61) - 1;
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+constexpr uint64_t mod_add(uint64_t a, uint64_t b)
+{
+    const uint64_t sum = a + b;
+    return sum >= BLINK_MODULUS ? sum - BLINK_MODULUS : sum;
+}
+
+constexpr uint64_t mod_mul(uint64_t a, uint64_t b)
+{
+    const uint128_t product = static_cast<uint128_t>(a) * b;
+
+    // 2^61 = 1 (mod 2^61 - 1), so the high bits fold back onto the low ones
+    uint64_t folded = static_cast<uint64_t>(product & BLINK_MODULUS) + static_cast<uint64_t>(product >> 61);
+    folded = (folded & BLINK_MODULUS) + (folded >> 61);
+
+    return folded >= BLINK_MODULUS ? folded - BLINK_MODULUS : folded;
+}
+
+constexpr uint64_t mod_pow(uint64_t base, uint64_t exponent)
+{
+    uint64_t result = 1;
+
+    for ( ; exponent > 0; exponent >>= 1 ) {
+        if ( exponent & 1 ) result = mod_mul(result, base);
+        base = mod_mul(base, base);
+    }
+
+    return result;
+}
+
+// Stone counts after arbitrary numbers of blinks, modulo BLINK_MODULUS.
+//
+// The stones reachable from the input form a closed set of a few thousand values, and
+// one blink is a sparse linear operator T on counts over that set. The total count
+// after N blinks is then a linear recurrence of order at most |set|, which
+// Berlekamp-Massey recovers from the first 2 |set| totals. The count after N blinks
+// follows from x^N modulo the recurrence's characteristic polynomial, computed by
+// repeated squaring. The squares x^(2^k) are cached and shared by every query, and a
+// batch of horizons only pays for the gaps between them.
+class BlinkOperator {
+public:
+    using Poly = std::vector<uint64_t>;
+
+    explicit BlinkOperator(const std::vector<uint64_t> &initial_stones)
+    {
+        std::unordered_map<uint64_t, uint32_t> state_of{};
+        std::vector<uint64_t> values{};
+
+        auto state = [&state_of, &values] (uint64_t stone) {
+            auto [it, inserted] = state_of.try_emplace(stone, static_cast<uint32_t>(values.size()));
+
+            if ( inserted ) {
+                values.push_back(stone);
+            }
+
+            return it->second;
+        };
+
+        std::vector<uint64_t> counts{};
+
+        for ( auto stone : initial_stones ) {
+            const uint32_t idx = state(stone);
+            counts.resize(values.size(), 0);
+            counts[idx] = mod_add(counts[idx], 1);
+        }
+
+        // Breadth-first over the closed set. `values` grows while it is walked.
+        for ( std::size_t i = 0; i < values.size(); i++ ) {
+            const uint64_t stone = values[i];
+            const std::size_t digits = digit_count(stone);
+
+            if ( stone == 0 ) {
+                successors.push_back({state(1), NO_STATE});
+            } else if ( digits % 2 == 0 ) {
+                auto [l, r] = split_digits(stone, digits);
+                const uint32_t left = state(l);
+                successors.push_back({left, state(r)});
+            } else {
+                successors.push_back({state(stone * 2024), NO_STATE});
+            }
+        }
+
+        counts.resize(values.size(), 0);
+
+        // Twice the state count is enough for Berlekamp-Massey to be exact
+        const std::size_t n_terms = 2 * values.size() + 2;
+        totals.reserve(n_terms);
+
+        for ( std::size_t n = 0; n < n_terms; n++ ) {
+            totals.push_back(std::accumulate(std::begin(counts), std::end(counts), uint64_t{0}, mod_add));
+            counts = step(counts);
+        }
+
+        recurrence = berlekamp_massey(totals);
+    }
+
+    std::size_t n_states() const { return successors.size(); }
+
+    std::size_t recurrence_order() const { return recurrence.size(); }
+
+    // Counts after each of the requested numbers of blinks, in the same order. The
+    // horizons are visited in ascending order and x^N is carried from one to the next,
+    // so nearby horizons cost a few shifts instead of a full exponentiation each.
+    std::vector<uint64_t> counts_after(const std::vector<uint64_t> &horizons)
+    {
+        std::vector<uint64_t> result(horizons.size(), 0);
+
+        std::vector<std::size_t> by_blinks(horizons.size());
+        std::iota(std::begin(by_blinks), std::end(by_blinks), std::size_t{0});
+        std::ranges::sort(by_blinks, {}, [&horizons] (std::size_t q) { return horizons[q]; });
+
+        // x^reached mod P
+        Poly power{1};
+        uint64_t reached = 0;
+
+        for ( auto q : by_blinks ) {
+            const uint64_t blinks = horizons[q];
+
+            if ( blinks < totals.size() ) {
+                result[q] = totals[blinks];
+                continue;
+            }
+
+            if ( recurrence.empty() ) {
+                continue;
+            }
+
+            power = advance(std::move(power), blinks - reached);
+            reached = blinks;
+
+            for ( std::size_t i = 0; i < power.size(); i++ ) {
+                result[q] = mod_add(result[q], mod_mul(power[i], totals[i]));
+            }
+        }
+
+        return result;
+    }
+
+    uint64_t count_after(uint64_t blinks)
+    {
+        return counts_after({blinks}).front();
+    }
+
+private:
+    static constexpr uint32_t NO_STATE = std::numeric_limits<uint32_t>::max();
+
+    // One blink applied to a count vector
+    std::vector<uint64_t> step(const std::vector<uint64_t> &counts) const
+    {
+        std::vector<uint64_t> next(counts.size(), 0);
+
+        for ( std::size_t i = 0; i < counts.size(); i++ ) {
+            auto [first, second] = successors[i];
+            next[first] = mod_add(next[first], counts[i]);
+
+            if ( second != NO_STATE ) {
+                next[second] = mod_add(next[second], counts[i]);
+            }
+        }
+
+        return next;
+    }
+
+    // Shortest r with s[n] = sum_i r[i] * s[n - 1 - i] for every n in the sequence
+    static Poly berlekamp_massey(const std::vector<uint64_t> &sequence)
+    {
+        Poly connection{1}, previous{1};
+        std::size_t length = 0, shift = 1;
+        uint64_t previous_discrepancy = 1;
+
+        for ( std::size_t n = 0; n < sequence.size(); n++ ) {
+            uint64_t discrepancy = 0;
+            for ( std::size_t i = 0; i <= length; i++ ) {
+                discrepancy = mod_add(discrepancy, mod_mul(connection[i], sequence[n - i]));
+            }
+
+            if ( discrepancy == 0 ) {
+                shift++;
+                continue;
+            }
+
+            const uint64_t factor = mod_mul(discrepancy, mod_pow(previous_discrepancy, BLINK_MODULUS - 2));
+            const Poly before = connection;
+
+            connection.resize(std::max(connection.size(), previous.size() + shift), 0);
+            for ( std::size_t i = 0; i < previous.size(); i++ ) {
+                connection[i + shift] = mod_add(connection[i + shift], BLINK_MODULUS - mod_mul(factor, previous[i]));
+            }
+
+            if ( 2 * length <= n ) {
+                length = n + 1 - length;
+                previous = before;
+                previous_discrepancy = discrepancy;
+                shift = 1;
+            } else {
+                shift++;
+            }
+        }
+
+        connection.resize(length + 1, 0);
+
+        Poly coefficients(length);
+        for ( std::size_t i = 0; i < length; i++ ) {
+            coefficients[i] = (BLINK_MODULUS - connection[i + 1]) % BLINK_MODULUS;
+        }
+
+        return coefficients;
+    }
+
+    // Reduces a polynomial modulo the characteristic polynomial of the recurrence
+    Poly reduce(Poly poly) const
+    {
+        const std::size_t order = recurrence.size();
+
+        // x^k = sum_i r[i] x^(k - 1 - i) for k >= order
+        for ( std::size_t k = poly.size(); k-- > order; ) {
+            const uint64_t coefficient = poly[k];
+
+            if ( coefficient == 0 ) {
+                continue;
+            }
+
+            for ( std::size_t i = 0; i < order; i++ ) {
+                poly[k - 1 - i] = mod_add(poly[k - 1 - i], mod_mul(coefficient, recurrence[i]));
+            }
+        }
+
+        poly.resize(std::min(poly.size(), order));
+        return poly;
+    }
+
+    Poly mul_mod(const Poly &lhs, const Poly &rhs) const
+    {
+        if ( lhs.empty() || rhs.empty() ) {
+            return {};
+        }
+
+        Poly product(lhs.size() + rhs.size() - 1, 0);
+
+        for ( std::size_t i = 0; i < lhs.size(); i++ ) {
+            if ( lhs[i] == 0 ) {
+                continue;
+            }
+
+            for ( std::size_t j = 0; j < rhs.size(); j++ ) {
+                product[i + j] = mod_add(product[i + j], mod_mul(lhs[i], rhs[j]));
+            }
+        }
+
+        return reduce(std::move(product));
+    }
+
+    // power * x^delta mod P. A step no longer than the recurrence is done one x at a
+    // time at O(order) each, anything longer goes through the cached squares.
+    Poly advance(Poly power, uint64_t delta)
+    {
+        if ( delta <= recurrence.size() ) {
+            for ( ; delta > 0; delta-- ) {
+                power.insert(std::begin(power), 0);
+                power = reduce(std::move(power));
+            }
+
+            return power;
+        }
+
+        // Shift a copy down instead of shifting by bit, which would hit 64 for the top bit
+        std::size_t bit = 0;
+        for ( uint64_t rest = delta; rest != 0; rest >>= 1, bit++ ) {
+            if ( rest & 1 ) {
+                power = mul_mod(power, square_power(bit));
+            }
+        }
+
+        return power;
+    }
+
+    // x^(2^bit) mod P
+    const Poly &square_power(std::size_t bit)
+    {
+        if ( squares.empty() ) {
+            squares.push_back(reduce(Poly{0, 1}));
+        }
+
+        while ( squares.size() <= bit ) {
+            squares.push_back(mul_mod(squares.back(), squares.back()));
+        }
+
+        return squares[bit];
+    }
+
+    std::vector<std::array<uint32_t, 2>> successors;
+
+    // Total stone count after n blinks, for the first few n
+    std::vector<uint64_t> totals;
+    Poly recurrence;
+    std::vector<Poly> squares;
+};
+
+std::vector<uint64_t> task3(std::filesystem::path path, const std::vector<uint64_t> &horizons)
+{
+    std::vector<uint64_t> stones = read_stones(path);
+
+    BlinkOperator engine{stones};
+
+    std::cout << std::format("{} reachable stones, recurrence of order {}\n", engine.n_states(), engine.recurrence_order());
+
+    return engine.counts_after(horizons);
+}
+
+} // namespace day11
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{11, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day11::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{11, "task2", [] (const std::filesystem::path &path) {
+    return aoc::answer(day11::task2(path));
+}};
+
+static aoc::RegisterTask register_task2_sharded{11, "task2_sharded", [] (const std::filesystem::path &path) {
+    return aoc::answer(day11::task2_sharded(path, std::thread::hardware_concurrency()));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -143,9 +786,28 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task2(file_to_read);
+    // Any further arguments are blink counts for the transition engine
+    if ( argc > 2 ) {
+        std::vector<uint64_t> horizons{};
+
+        for ( int i = 2; i < argc; i++ ) {
+            horizons.push_back(aoc::expect_int<uint64_t>(argv[i]));
+        }
+
+        auto counts = day11::task3(file_to_read, horizons);
+
+        for ( std::size_t i = 0; i < horizons.size(); i++ ) {
+            std::cout << std::format("After {} blinks: {} (mod 2^61 - 1)\n", horizons[i], counts[i]);
+        }
+
+        return 0;
+    }
+
+    auto t1 = day11::task2_sharded(file_to_read, std::thread::hardware_concurrency());
 
     std::cout << std::format("Result: {}\n", t1);
 
     return 0;
 }
+
+#endif
@@ -1,15 +1,22 @@
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <execution>
 #include <format>
 #include <iterator>
+#include <limits>
 #include <numeric>
-#include <sstream>
+#include <thread>
 #include <algorithm>
 #include <vector>
-#include <unordered_map>
+
+#include "input.h"
+#include "runner.h"
+
+namespace day12 {
 
 
 struct Vec2 {
@@ -27,10 +34,49 @@ struct Vec2Hash {
     }
 };
 
+// Plants packed at 5 bits each, 12 to a word. Codes index into the alphabet in the
+// order the plants first show up.
+struct PackedPlants {
+    static constexpr std::size_t BITS = 5;
+    static constexpr std::size_t PER_WORD = 64 / BITS;
+    static constexpr std::size_t MAX_CODES = 1 << BITS;
+
+    uint8_t operator[](std::size_t idx) const {
+        return uint8_t(words[idx / PER_WORD] >> (idx % PER_WORD * BITS)) & (MAX_CODES - 1);
+    }
+
+    void push_back(uint8_t code) {
+        if ( n_plants % PER_WORD == 0 ) {
+            words.push_back(0);
+        }
+
+        words.back() |= uint64_t{code} << (n_plants % PER_WORD * BITS);
+        n_plants++;
+    }
+
+    std::size_t size() const {
+        return n_plants;
+    }
+
+    std::vector<uint64_t> words;
+    std::size_t n_plants = 0;
+
+    std::array<unsigned char, MAX_CODES> alphabet{};
+    std::size_t n_codes = 0;
+};
+
+// Label is uint16_t or uint32_t, whichever is the smallest that fits every cell of the
+// garden (see fits_labels). 0 is never handed out as a label.
+template <class Label>
 struct GardenPlot {
 
+    GardenPlot(PackedPlants &&plants_, std::size_t nx_, std::size_t ny_)
+        : componentIDs(plants_.size(), 0), plants(std::move(plants_)), nx(nx_), ny(ny_)
+    {
+    }
+
     unsigned char at(Vec2 pos) const {
-        return plants[nx*std::size_t(pos.y) + std::size_t(pos.x)];
+        return plants.alphabet[plants[nx*std::size_t(pos.y) + std::size_t(pos.x)]];
     }
 
     template <class Self>
@@ -44,148 +90,479 @@ struct GardenPlot {
             pos.y >= 0 && pos.y < ny;
     }
 
+    // Labels run up to the cell count + 1, and the parallel labeler parks cell indices in
+    // componentIDs for a while
+    static bool fits_labels(std::size_t n_cells) {
+        return n_cells < std::numeric_limits<Label>::max();
+    }
+
 
-    std::vector<bool> visited;
-    std::vector<uint64_t> componentIDs;
+    std::vector<Label> componentIDs;
 
-    uint64_t componentID_counter{1};
+    uint32_t componentID_counter{1};
 
-    std::vector<unsigned char> plants;
+    PackedPlants plants;
     std::size_t nx = 0, ny = 0;
 };
 
+struct RawGarden {
+    PackedPlants plants;
+    std::size_t nx = 0, ny = 0;
+};
 
 
-GardenPlot read_garden(std::ifstream &fh)
+RawGarden read_garden(const aoc::InputBuffer &input)
 {
-    GardenPlot plot{};
+    RawGarden garden{};
 
     uint64_t nx{0}, ny{0};
 
+    std::array<int, 256> code_of{};
+    code_of.fill(-1);
 
-    std::string current_line{};
-    while ( std::getline(fh, current_line) ) {
+    for ( auto current_line : aoc::lines(input.view()) ) {
         ny++;
         nx = std::max(nx,current_line.size());
 
         for ( auto c : current_line ) {
-            plot.plants.emplace_back(c);
+            auto &code = code_of[static_cast<unsigned char>(c)];
+
+            if ( code < 0 ) {
+                if ( garden.plants.n_codes == PackedPlants::MAX_CODES ) {
+                    std::cerr << std::format("More than {} different plants, can't pack '{}'\n", PackedPlants::MAX_CODES, c);
+                    std::abort();
+                }
+
+                code = static_cast<int>(garden.plants.n_codes);
+                garden.plants.alphabet[garden.plants.n_codes++] = static_cast<unsigned char>(c);
+            }
+
+            garden.plants.push_back(static_cast<uint8_t>(code));
         }
     }
 
-    plot.nx = nx;
-    plot.ny = ny;
-
-    plot.visited.resize(plot.plants.size(), false);
-    plot.componentIDs.resize(plot.plants.size(), false);
+    garden.nx = nx;
+    garden.ny = ny;
 
-    return plot;
+    return garden;
 }
 
-static constexpr std::array<Vec2, 4> directions{
-    Vec2{1,0},
-    Vec2{-1,0},
-    Vec2{0,1},
-    Vec2{0,-1},
+
+// Union-find over flat cell indices. The smaller index always becomes the root, so
+// every component's root is its first cell in scan order.
+struct DisjointSets {
+    std::vector<uint32_t> parent;
+
+    explicit DisjointSets(std::size_t n)
+        : parent(n)
+    {
+        std::iota(std::begin(parent), std::end(parent), uint32_t{0});
+    }
+
+    uint32_t find(uint32_t i) {
+        // Path halving
+        while ( parent[i] != i ) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+
+        return i;
+    }
+
+    void unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+
+        if ( a < b ) {
+            parent[b] = a;
+        } else if ( b < a ) {
+            parent[a] = b;
+        }
+    }
 };
 
-void fill_component_extension(GardenPlot &plot, Vec2 pos, unsigned char plant, uint64_t component)
+// Two-pass scanline labeling. The first pass joins every cell with its left and upper
+// neighbor when they hold the same plant, the second one hands out dense labels
+// starting at 1 in scan order.
+template <class Label>
+void label_components(GardenPlot<Label> &plot)
 {
-    // Already visited
-    if ( plot.component_at(pos) > 0 ) return;
+    assert(plot.fits_labels(plot.plants.size()) && "Garden too large for its label width");
 
-    if ( plot.at(pos) == plant ) {
-        plot.component_at(pos) = component;
+    DisjointSets sets{plot.plants.size()};
 
-        for ( auto dir : directions ) {
-            Vec2 new_pos = pos + dir;
+    for ( std::size_t y = 0; y < plot.ny; y++ ) {
+        for ( std::size_t x = 0; x < plot.nx; x++ ) {
+            const auto idx = static_cast<uint32_t>(y * plot.nx + x);
 
-            if ( ! plot.isInside(new_pos) ) continue;
+            if ( x > 0 && plot.plants[idx - 1] == plot.plants[idx] ) {
+                sets.unite(idx, idx - 1);
+            }
 
-            fill_component_extension(plot, new_pos, plant, component);
+            if ( y > 0 && plot.plants[idx - plot.nx] == plot.plants[idx] ) {
+                sets.unite(idx, static_cast<uint32_t>(idx - plot.nx));
+            }
         }
     }
+
+    for ( uint32_t idx = 0; idx < plot.plants.size(); idx++ ) {
+        const uint32_t root = sets.find(idx);
+
+        // Roots come first in scan order, so they are labeled before the rest
+        plot.componentIDs[idx] = root == idx ? static_cast<Label>(plot.componentID_counter++) : plot.componentIDs[root];
+    }
 }
 
-void fill_component(GardenPlot &plot, Vec2 pos)
+// Union-find that tolerates concurrent unite/find calls. Roots are only ever linked
+// below a smaller root with a CAS, which keeps the forest acyclic and the root of a
+// component at its first cell in scan order, same as DisjointSets. No other data is
+// published through the parent links, so relaxed ordering suffices.
+struct ConcurrentDisjointSets {
+    std::vector<std::atomic<uint32_t>> parent;
+
+    explicit ConcurrentDisjointSets(std::size_t n)
+        : parent(n)
+    {
+    }
+
+    void reset(uint32_t begin, uint32_t end) {
+        for ( uint32_t i = begin; i < end; i++ ) {
+            parent[i].store(i, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t find(uint32_t i) {
+        uint32_t p = parent[i].load(std::memory_order_relaxed);
+
+        while ( p != i ) {
+            // Path halving, losing the race just means someone else shortened it
+            uint32_t gp = parent[p].load(std::memory_order_relaxed);
+            parent[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+
+            i = gp;
+            p = parent[i].load(std::memory_order_relaxed);
+        }
+
+        return i;
+    }
+
+    bool is_root(uint32_t i) const {
+        return parent[i].load(std::memory_order_relaxed) == i;
+    }
+
+    void unite(uint32_t a, uint32_t b) {
+        while ( true ) {
+            a = find(a);
+            b = find(b);
+
+            if ( a == b ) {
+                return;
+            }
+
+            if ( a > b ) {
+                std::swap(a, b);
+            }
+
+            // b may have been linked elsewhere in the meantime, then retry from the new roots
+            uint32_t expected = b;
+            if ( parent[b].compare_exchange_strong(expected, a, std::memory_order_relaxed) ) {
+                return;
+            }
+        }
+    }
+};
+
+// Parallel version of label_components. The garden is cut into row bands which are
+// labeled independently, then the first row of each band is joined with the last row of
+// the band above it. Labels are identical to the sequential labeler.
+template <class Label>
+void label_components_parallel(GardenPlot<Label> &plot, std::size_t n_bands)
 {
-    unsigned  char plant = plot.at(pos);
-    auto ID = plot.component_at(pos);
+    assert(plot.fits_labels(plot.plants.size()) && "Garden too large for its label width");
+
+    n_bands = std::clamp<std::size_t>(n_bands, 1, std::max<std::size_t>(plot.ny, 1));
 
-    if ( ID > 0 ) {
+    if ( n_bands == 1 ) {
+        label_components(plot);
         return;
     }
 
-    uint64_t new_component_id = plot.componentID_counter++;
+    const std::size_t band_rows = (plot.ny + n_bands - 1) / n_bands;
+    n_bands = (plot.ny + band_rows - 1) / band_rows;
 
-    // plot.component_at(pos) = new_component_id;
-    fill_component_extension(plot, pos, plant, new_component_id);
+    std::vector<std::size_t> bands(n_bands);
+    std::iota(std::begin(bands), std::end(bands), std::size_t{0});
+
+    auto band_begin = [&plot, band_rows] (std::size_t band) {
+        return static_cast<uint32_t>(band * band_rows * plot.nx);
+    };
+
+    auto band_end = [&plot, band_rows] (std::size_t band) {
+        return static_cast<uint32_t>(std::min((band + 1) * band_rows, plot.ny) * plot.nx);
+    };
+
+    ConcurrentDisjointSets sets{plot.plants.size()};
+
+    // Local scanline pass, nothing crosses a band so no contention here
+    std::for_each(std::execution::par, std::begin(bands), std::end(bands), [&] (std::size_t band) {
+        const uint32_t begin = band_begin(band), end = band_end(band);
+        sets.reset(begin, end);
+
+        for ( uint32_t idx = begin; idx < end; idx++ ) {
+            if ( idx % plot.nx > 0 && plot.plants[idx - 1] == plot.plants[idx] ) {
+                sets.unite(idx, idx - 1);
+            }
+
+            if ( idx >= begin + plot.nx && plot.plants[idx - plot.nx] == plot.plants[idx] ) {
+                sets.unite(idx, static_cast<uint32_t>(idx - plot.nx));
+            }
+        }
+    });
+
+    // Stitch the borders
+    std::for_each(std::execution::par, std::next(std::begin(bands)), std::end(bands), [&] (std::size_t band) {
+        const uint32_t begin = band_begin(band);
+
+        for ( uint32_t idx = begin; idx < begin + plot.nx; idx++ ) {
+            if ( plot.plants[idx - plot.nx] == plot.plants[idx] ) {
+                sets.unite(idx, static_cast<uint32_t>(idx - plot.nx));
+            }
+        }
+    });
+
+    // Resolve every cell to its root and count the roots of each band
+    std::vector<uint32_t> roots_per_band(n_bands);
+    std::for_each(std::execution::par, std::begin(bands), std::end(bands), [&] (std::size_t band) {
+        uint32_t n_roots = 0;
+
+        for ( uint32_t idx = band_begin(band); idx < band_end(band); idx++ ) {
+            plot.componentIDs[idx] = static_cast<Label>(sets.find(idx));
+            n_roots += plot.componentIDs[idx] == idx;
+        }
+
+        roots_per_band[band] = n_roots;
+    });
+
+    std::vector<uint32_t> first_label(n_bands);
+    std::exclusive_scan(std::begin(roots_per_band), std::end(roots_per_band), std::begin(first_label),
+                        plot.componentID_counter);
+
+    // Roots get their dense label first, then everybody else looks it up. Roots are never
+    // written in the second pass, so reading across bands is fine.
+    std::for_each(std::execution::par, std::begin(bands), std::end(bands), [&] (std::size_t band) {
+        uint32_t label = first_label[band];
+
+        for ( uint32_t idx = band_begin(band); idx < band_end(band); idx++ ) {
+            if ( sets.is_root(idx) ) {
+                plot.componentIDs[idx] = static_cast<Label>(label++);
+            }
+        }
+    });
+
+    std::for_each(std::execution::par, std::begin(bands), std::end(bands), [&] (std::size_t band) {
+        for ( uint32_t idx = band_begin(band); idx < band_end(band); idx++ ) {
+            if ( ! sets.is_root(idx) ) {
+                plot.componentIDs[idx] = plot.componentIDs[plot.componentIDs[idx]];
+            }
+        }
+    });
+
+    plot.componentID_counter = first_label.back() + roots_per_band.back();
 }
 
 
 
-uint64_t task1(std::filesystem::path path)
-{
-    std::ifstream fh{path};
+// Per-region totals, indexed directly by label
+struct RegionStats {
+    std::vector<uint64_t> area;
+    std::vector<uint64_t> perimeter;
+    std::vector<uint64_t> sides;
 
-    if ( ! fh.is_open() ) {
-        std::cerr << std::format("Couldn't open {}!\n", path.string());
+    explicit RegionStats(std::size_t n_labels)
+        : area(n_labels), perimeter(n_labels), sides(n_labels)
+    {
+    }
+
+    void add(std::size_t idx, uint64_t cell_perimeter, uint64_t cell_sides) {
+        area[idx]++;
+        perimeter[idx] += cell_perimeter;
+        sides[idx] += cell_sides;
     }
+};
+
+// Totals a band collects for regions that started in an earlier band. Such a region has
+// to pass through the band's top row to get in, so there are at most nx of them.
+struct SpilledStats {
+    std::vector<uint32_t> labels;
+    RegionStats stats{0};
+};
 
+// Accumulate area, perimeter and sides for the rows [y_begin, y_end). A region has as
+// many sides as corners, and each cell owns up to four of them: one per 2x2 window it
+// sits in. Looking from the cell towards a diagonal, it's a convex corner if neither
+// orthogonal neighbor is in the region, and a concave one if both are but the diagonal
+// isn't.
+//
+// Labels from first_owned up are written straight into owned, no other band touches
+// them. Anything below that came from above and goes to spill.
+template <class Label>
+void accumulate_rows(const GardenPlot<Label> &plot, RegionStats &owned, SpilledStats &spill, uint32_t first_owned,
+                     std::size_t y_begin, std::size_t y_end)
+{
+    const auto nx = static_cast<int64_t>(plot.nx), ny = static_cast<int64_t>(plot.ny);
 
-    auto plot = read_garden(fh);
-    fh.close();
+    // Labels start at 1, so 0 works as "outside"
+    auto label = [&plot, nx, ny] (int64_t x, int64_t y) -> uint32_t {
+        if ( x < 0 || y < 0 || x >= nx || y >= ny ) {
+            return 0;
+        }
+        return plot.componentIDs[std::size_t(y * nx + x)];
+    };
 
-    for ( auto y = 0; y < plot.ny; y++ ) {
-        for ( auto x = 0; x < plot.nx; x++ ) {
-            fill_component(plot, Vec2{x,y});
+    if ( y_begin < y_end ) {
+        for ( int64_t x = 0; x < nx; x++ ) {
+            if ( uint32_t c = label(x, static_cast<int64_t>(y_begin)); c < first_owned ) {
+                spill.labels.push_back(c);
+            }
         }
+
+        std::ranges::sort(spill.labels);
+        spill.labels.erase(std::unique(std::begin(spill.labels), std::end(spill.labels)), std::end(spill.labels));
+        spill.stats = RegionStats{spill.labels.size()};
     }
 
-    std::cout << "Task 1 finished\n";
+    for ( auto y = static_cast<int64_t>(y_begin); y < static_cast<int64_t>(y_end); y++ ) {
+        for ( int64_t x = 0; x < nx; x++ ) {
+            const uint32_t c = label(x, y);
 
-    std::unordered_map<uint64_t, uint64_t> areas{};
-    std::unordered_map<uint64_t, uint64_t> circumferences{};
-    std::unordered_map<uint64_t, unsigned char> component_char{};
+            const bool left = label(x - 1, y) == c, right = label(x + 1, y) == c;
+            const bool up = label(x, y - 1) == c, down = label(x, y + 1) == c;
 
-    for ( auto y = 0; y < plot.ny; y++ ) {
-        for ( auto x = 0; x < plot.nx; x++ ) {
+            uint64_t corners = 0;
+            corners += (!left && !up) + (left && up && label(x - 1, y - 1) != c);
+            corners += (!right && !up) + (right && up && label(x + 1, y - 1) != c);
+            corners += (!left && !down) + (left && down && label(x - 1, y + 1) != c);
+            corners += (!right && !down) + (right && down && label(x + 1, y + 1) != c);
 
-            unsigned char thisChar = plot.at({x,y});
-            uint64_t component = plot.component_at(Vec2{x,y});
-            component_char[component] = thisChar;
+            const uint64_t perimeter = uint64_t(!left) + !right + !up + !down;
 
-            areas[component] += 1;
+            if ( c >= first_owned ) {
+                owned.add(c, perimeter, corners);
+            } else {
+                auto it = std::ranges::lower_bound(spill.labels, c);
+                spill.stats.add(std::size_t(it - std::begin(spill.labels)), perimeter, corners);
+            }
+        }
+    }
+}
 
-            for ( auto dir : directions ) {
-                Vec2 new_point = Vec2{x,y} + dir;
+// One sweep over the labeled plot. Labels are handed out in scan order, so every band
+// owns the labels of the regions that start in it, a range no other band owns. Bands
+// write those straight into the shared totals. Only the few regions reaching down from
+// earlier bands are collected on the side and added afterwards.
+template <class Label>
+RegionStats region_stats(const GardenPlot<Label> &plot, std::size_t n_bands)
+{
+    n_bands = std::clamp<std::size_t>(n_bands, 1, std::max<std::size_t>(plot.ny, 1));
+    const std::size_t band_rows = (plot.ny + n_bands - 1) / n_bands;
+
+    std::vector<std::size_t> bands(n_bands);
+    std::iota(std::begin(bands), std::end(bands), std::size_t{0});
+
+    auto rows_of = [&plot, band_rows] (std::size_t band) {
+        const std::size_t y_begin = std::min(band * band_rows, plot.ny);
+        return std::make_pair(y_begin, std::min(y_begin + band_rows, plot.ny));
+    };
+
+    std::vector<uint32_t> max_label(n_bands);
+    std::for_each(std::execution::par, std::begin(bands), std::end(bands), [&] (std::size_t band) {
+        auto [y_begin, y_end] = rows_of(band);
+        auto first = std::begin(plot.componentIDs) + std::ptrdiff_t(y_begin * plot.nx);
+        auto last = std::begin(plot.componentIDs) + std::ptrdiff_t(y_end * plot.nx);
+        max_label[band] = first == last ? 0 : *std::max_element(first, last);
+    });
+
+    // A band owns everything above the largest label seen in any band before it. That
+    // isn't simply the previous band's max, a region from further up can cover all of it.
+    std::vector<uint32_t> first_owned(n_bands);
+    uint32_t seen = 0;
+    for ( std::size_t band = 0; band < n_bands; band++ ) {
+        first_owned[band] = seen + 1;
+        seen = std::max(seen, max_label[band]);
+    }
 
-                if ( ! plot.isInside(new_point) ) {
-                    circumferences[component]++;
-                    continue;
-                }
+    RegionStats stats{plot.componentID_counter};
+    std::vector<SpilledStats> spills(n_bands);
 
-                if ( plot.at(new_point) != thisChar ) {
-                    circumferences[component]++;
-                }
-            }
+    std::for_each(std::execution::par, std::begin(bands), std::end(bands), [&] (std::size_t band) {
+        auto [y_begin, y_end] = rows_of(band);
+        accumulate_rows(plot, stats, spills[band], first_owned[band], y_begin, y_end);
+    });
+
+    for ( const auto &spill : spills ) {
+        for ( std::size_t i = 0; i < spill.labels.size(); i++ ) {
+            stats.area[spill.labels[i]] += spill.stats.area[i];
+            stats.perimeter[spill.labels[i]] += spill.stats.perimeter[i];
+            stats.sides[spill.labels[i]] += spill.stats.sides[i];
         }
     }
 
-    std::cout << "task 1 finished\n";
+    return stats;
+}
 
-    auto result = 0ULL;
+template <class Label>
+std::pair<uint64_t, uint64_t> fence_prices(GardenPlot<Label> &plot)
+{
+    // A few bands per thread so uneven rows don't leave cores idle
+    label_components_parallel(plot, 4 * std::thread::hardware_concurrency());
 
+    auto stats = region_stats(plot, 4 * std::thread::hardware_concurrency());
 
+    uint64_t perimeter_price = 0, sides_price = 0;
 
-    for ( auto i = 0ULL; i < plot.componentID_counter; i++ ) {
-        std::cout << std::format("Component {} with char {} has area {} and circumference {}\n", i, char(component_char[i]), areas[i], circumferences[i]);
-        result += circumferences[i] * areas[i];
+    for ( std::size_t i = 1; i < plot.componentID_counter; i++ ) {
+        perimeter_price += stats.area[i] * stats.perimeter[i];
+        sides_price += stats.area[i] * stats.sides[i];
     }
 
-    return result;
+    return {perimeter_price, sides_price};
 }
 
+std::pair<uint64_t, uint64_t> task1(std::filesystem::path path)
+{
+    aoc::InputBuffer input{path};
+
+    if ( ! input.is_open() ) {
+        std::cerr << std::format("Couldn't open {}!\n", path.string());
+    }
+
+    auto garden = read_garden(input);
+
+    // Most gardens fit 16-bit labels, which halves the label grid
+    if ( GardenPlot<uint16_t>::fits_labels(garden.plants.size()) ) {
+        GardenPlot<uint16_t> plot{std::move(garden.plants), garden.nx, garden.ny};
+        return fence_prices(plot);
+    }
+
+    if ( ! GardenPlot<uint32_t>::fits_labels(garden.plants.size()) ) {
+        std::cerr << std::format("Garden with {} cells is too large for 32-bit labels\n", garden.plants.size());
+        std::abort();
+    }
+
+    GardenPlot<uint32_t> plot{std::move(garden.plants), garden.nx, garden.ny};
+    return fence_prices(plot);
+}
+
+} // namespace day12
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{12, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day12::task1(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -199,9 +576,12 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
+    auto [t1, t2] = day12::task1(file_to_read);
 
-    std::cout << std::format("Result: {}\n", t1);
+    std::cout << std::format("Task 1: {}\n", t1);
+    std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
@@ -1,5 +1,4 @@
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <list>
 #include <string>
@@ -8,22 +7,10 @@
 #include <vector>
 #include <ranges>
 
+#include "input.h"
+#include "runner.h"
 
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
-
-    TypeT current;
-
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
-
-    return result;
-}
-
+namespace day2 {
 
 
 bool safe_pair( int64_t fst, int64_t snd, int64_t sign )
@@ -54,18 +41,16 @@ bool is_safe(std::vector<int64_t> &report)
 std::size_t task1(std::filesystem::path path)
 {
 
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
     std::size_t safe_reports = 0;
 
-    while ( std::getline(fh, current_line) ) {
-        std::istringstream ss{current_line};
-        std::vector<int64_t> report = consumeStream<int64_t>(ss);
+    for ( auto line : aoc::lines(input.view()) ) {
+        std::vector<int64_t> report = aoc::parse_ints<int64_t>(line);
         safe_reports += is_safe(report); // == true ? 1 : 0;
     }
 
@@ -92,24 +77,36 @@ bool dampened_safe_report(std::vector<int64_t> &report)
 
 std::size_t task2(std::filesystem::path path)
 {
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
     std::size_t safe_reports = 0;
 
-    while ( std::getline(fh, current_line) ) {
-        std::istringstream ss{current_line};
-        std::vector<int64_t> report = consumeStream<int64_t>(ss);
+    for ( auto line : aoc::lines(input.view()) ) {
+        std::vector<int64_t> report = aoc::parse_ints<int64_t>(line);
         safe_reports += dampened_safe_report(report);
     }
 
     return safe_reports;
 }
 
+} // namespace day2
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{2, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day2::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{2, "task2", [] (const std::filesystem::path &path) {
+    return aoc::answer(day2::task2(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -123,11 +120,13 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
-    auto t2 = task2(file_to_read);
+    auto t1 = day2::task1(file_to_read);
+    auto t2 = day2::task2(file_to_read);
 
     std::cout << std::format("Task 1: {}\n", t1);
     std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
@@ -1,5 +1,4 @@
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <list>
 #include <string>
@@ -8,22 +7,10 @@
 #include <vector>
 #include <ranges>
 
+#include "input.h"
+#include "runner.h"
 
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
-
-    TypeT current;
-
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
-
-    return result;
-}
-
+namespace day4 {
 
 
 std::size_t find_xmas(const std::vector<std::vector<char>> &instance, std::size_t N, std::size_t y, std::size_t x, int dy, int dx, std::size_t progress)
@@ -50,20 +37,16 @@ std::size_t find_xmas(const std::vector<std::vector<char>> &instance, std::size_
 std::size_t task1(std::filesystem::path path)
 {
 
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
-
     std::vector<std::vector<char>> problem{};
 
-
-    while ( std::getline(fh, current_line) ) {
-        std::istringstream ss{current_line};
-        problem.emplace_back(consumeStream<char>(ss));
+    for ( auto line : aoc::lines(input.view()) ) {
+        problem.emplace_back(std::begin(line), std::end(line));
     }
 
     std::size_t all = 0;
@@ -82,28 +65,22 @@ std::size_t task1(std::filesystem::path path)
         }
     }
 
-    std::cout << all << "\n";
-
-    return 0;
+    return all;
 }
 
 std::size_t task2(std::filesystem::path path)
 {
 
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
-
     std::vector<std::vector<char>> problem{};
 
-
-    while ( std::getline(fh, current_line) ) {
-        std::istringstream ss{current_line};
-        problem.emplace_back(consumeStream<char>(ss));
+    for ( auto line : aoc::lines(input.view()) ) {
+        problem.emplace_back(std::begin(line), std::end(line));
     }
 
     std::size_t all = 0;
@@ -125,12 +102,22 @@ std::size_t task2(std::filesystem::path path)
         }
     }
 
-    std::cout << all << "\n";
-
-    return 0;
+    return all;
 }
 
+} // namespace day4
 
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{4, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day4::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{4, "task2", [] (const std::filesystem::path &path) {
+    return aoc::answer(day4::task2(path));
+}};
+
+#else
 
 int main(int argc, char *argv[])
 {
@@ -145,11 +132,13 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
-    auto t2 = task2(file_to_read);
+    auto t1 = day4::task1(file_to_read);
+    auto t2 = day4::task2(file_to_read);
 
     std::cout << std::format("Task 1: {}\n", t1);
     std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
@@ -1,5 +1,4 @@
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <list>
 #include <numeric>
@@ -9,58 +8,40 @@
 #include <vector>
 #include <ranges>
 
+#include "input.h"
+#include "runner.h"
 
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
-
-    TypeT current;
-
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
-
-    return result;
-}
-
-
+namespace day5 {
 
 
 int task1(std::filesystem::path path)
 {
 
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
+    auto all_lines = aoc::lines(input.view());
+    auto line = std::begin(all_lines);
 
     std::vector<std::pair<int, int>> orderings{};
 
-    while ( std::getline(fh, current_line) && current_line != "" ) {
-        std::istringstream ss{current_line};
-
-        char sep;
-        int page1;
-        int page2;
-
-        ss >> page1 >> sep >> page2;
+    // Rules like 47|53 up to the first blank line
+    for ( ; line != std::end(all_lines) && ! (*line).empty(); ++line ) {
+        auto rule = aoc::parse_ints<int>(*line, '|');
+        orderings.emplace_back(std::make_pair(rule.at(0), rule.at(1)));
+    }
 
-        orderings.emplace_back(std::make_pair(page1, page2));
+    if ( line != std::end(all_lines) ) {
+        ++line;
     }
 
     int sumOfMiddles = 0;
 
-    while ( std::getline(fh, current_line) ) {
-        std::vector<int> pages{};
-        for ( const auto &word : std::views::split(current_line, ',') ) {
-            int pageNo = std::stoi(std::string{std::begin(word), std::end(word)});
-            pages.emplace_back(pageNo);
-        }
+    for ( ; line != std::end(all_lines); ++line ) {
+        std::vector<int> pages = aoc::parse_ints<int>(*line, ',');
 
 
         bool isValid = true;
@@ -95,38 +76,31 @@ int task1(std::filesystem::path path)
 int task2(std::filesystem::path path)
 {
 
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
+    auto all_lines = aoc::lines(input.view());
+    auto line = std::begin(all_lines);
 
     std::vector<std::pair<int, int>> orderings{};
 
-    while ( std::getline(fh, current_line) && current_line != "" ) {
-        std::istringstream ss{current_line};
-
-        char sep;
-        int page1;
-        int page2;
-
-        ss >> page1 >> sep >> page2;
-
-        orderings.emplace_back(std::make_pair(page1, page2));
+    // Rules like 47|53 up to the first blank line
+    for ( ; line != std::end(all_lines) && ! (*line).empty(); ++line ) {
+        auto rule = aoc::parse_ints<int>(*line, '|');
+        orderings.emplace_back(std::make_pair(rule.at(0), rule.at(1)));
+    }
 
-        // std::cout << std::format("Page {} must come before Page {}\n",page1,page2);
+    if ( line != std::end(all_lines) ) {
+        ++line;
     }
 
     int sumOfMiddles = 0;
 
-    while ( std::getline(fh, current_line) ) {
-        std::vector<int> pages{};
-        for ( const auto &word : std::views::split(current_line, ',') ) {
-            int pageNo = std::stoi(std::string{std::begin(word), std::end(word)});
-            pages.emplace_back(pageNo);
-        }
+    for ( ; line != std::end(all_lines); ++line ) {
+        std::vector<int> pages = aoc::parse_ints<int>(*line, ',');
 
 
         bool isValid = true;
@@ -159,6 +133,20 @@ int task2(std::filesystem::path path)
 
 }
 
+} // namespace day5
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{5, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day5::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{5, "task2", [] (const std::filesystem::path &path) {
+    return aoc::answer(day5::task2(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -172,11 +160,13 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
-    auto t2 = task2(file_to_read);
+    auto t1 = day5::task1(file_to_read);
+    auto t2 = day5::task2(file_to_read);
 
     std::cout << std::format("Task 1: {}\n", t1);
     std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
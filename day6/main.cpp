@@ -1,7 +1,6 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <list>
 #include <execution>
@@ -11,21 +10,11 @@
 #include <unordered_map>
 #include <vector>
 
+#include "input.h"
+#include "runner.h"
 
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
-
-    TypeT current;
+namespace day6 {
 
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
-
-    return result;
-}
 
 struct Vec2 {
     int64_t x;
@@ -126,16 +115,19 @@ GuardMap read_map(std::filesystem::path path)
 
     GuardMap result{};
 
-    std::fstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Failed to open file {} for task 1\n", path.string());
     }
 
-    std::string current_line;
     int64_t ny = 0;
 
-    while ( std::getline(fh, current_line) && current_line != "" ) {
+    for ( auto current_line : aoc::lines(input.view()) ) {
+        if ( current_line.empty() ) {
+            break;
+        }
+
         ny++;
 
         result.nx = static_cast<int64_t>(current_line.length());
@@ -255,6 +247,19 @@ int64_t task2(std::filesystem::path path)
     return loopWays;
 }
 
+} // namespace day6
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{6, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day6::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{6, "task2", [] (const std::filesystem::path &path) {
+    return aoc::answer(day6::task2(path));
+}};
+
+#else
 
 int main(int argc, char *argv[])
 {
@@ -269,20 +274,22 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
+    auto t1 = day6::task1(file_to_read);
 
 
     auto hires = std::chrono::high_resolution_clock{};
     auto start = hires.now();
 
-    auto t2 = task2(file_to_read);
+    auto t2 = day6::task2(file_to_read);
 
     auto end = hires.now();
 
-    std::cout << std::format("Task 2 took {} ns\n", std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+    std::cout << std::format("Task 2 took {} ms\n", std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
 
     std::cout << std::format("Task 1: {}\n", t1);
     std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
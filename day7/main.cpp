@@ -1,7 +1,6 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <list>
 #include <execution>
@@ -12,54 +11,37 @@
 #include <unordered_map>
 #include <vector>
 
-#define CONCAT
-
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
+#include "input.h"
+#include "runner.h"
 
-    TypeT current;
-
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
+#define CONCAT
 
-    return result;
-}
+namespace day7 {
 
 struct Equation {
     uint64_t lhs;
     std::vector<uint64_t> rhs;
 };
 
-std::vector<Equation> read_equations(std::ifstream &fh)
+std::vector<Equation> read_equations(const aoc::InputBuffer &input)
 {
-    std::string current_line{};
-
     std::vector<Equation> equations{};
 
-    while ( std::getline(fh, current_line) ) {
-        std::string_view sv{current_line};
-
-        auto colon_iter = std::find(std::begin(sv), std::end(sv), ':');
-
-        std::string lhs{std::begin(sv), colon_iter};
-        std::string rhs{std::next(colon_iter), std::end(sv)};
-
-        Equation current_eq{};
-        current_eq.lhs = std::stoull(lhs);
-
-        std::stringstream rhs_stream{std::string{rhs}};
+    // 190: 10 19
+    for ( auto line : aoc::lines(input.view()) ) {
+        if ( line.empty() ) {
+            continue;
+        }
 
-        uint64_t operand = 0;
+        auto lhs = aoc::consume_int<uint64_t>(line);
 
-        while ( rhs_stream >> operand ) {
-            current_eq.rhs.emplace_back(operand);
+        if ( ! lhs || line.empty() || line.front() != ':' ) {
+            std::cerr << std::format("Malformed equation '{}'\n", line);
+            std::abort();
         }
 
-        equations.emplace_back(std::move(current_eq));
+        line.remove_prefix(1);
+        equations.emplace_back(Equation{*lhs, aoc::parse_ints<uint64_t>(line)});
     }
 
     return equations;
@@ -121,13 +103,13 @@ bool try_solve(Equation &eq) {
 uint64_t task1(std::filesystem::path path)
 {
 
-    std::ifstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Couldn't open {}!\n", path.string());
     }
 
-    auto equations = read_equations(fh);
+    auto equations = read_equations(input);
 
 
     return std::transform_reduce(std::execution::par, std::begin(equations), std::end(equations),
@@ -139,6 +121,16 @@ uint64_t task1(std::filesystem::path path)
 
 }
 
+} // namespace day7
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{7, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day7::task1(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -152,9 +144,11 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
+    auto t1 = day7::task1(file_to_read);
 
     std::cout << std::format("Result: {}\n", t1);
 
     return 0;
 }
+
+#endif
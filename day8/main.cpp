@@ -1,37 +1,35 @@
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
-#include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <list>
+#include <numeric>
 #include <execution>
 #include <ranges>
 #include <set>
 #include <string>
+#include <thread>
 #include <filesystem>
 #include <format>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
-static constexpr bool PART2 = true;
+#include "input.h"
+#include "runner.h"
 
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
-
-    TypeT current;
-
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
+namespace day8 {
 
-    return result;
-}
+// Index into per-part accumulators
+enum Part : std::size_t {
+    PART1 = 0,
+    PART2 = 1,
+};
 
 struct Vec2 {
     int64_t x;
@@ -49,13 +47,198 @@ struct Vec2_hash {
     }
 };
 
+// Enumerates the pair (antenna1, antenna2) once. part1_fn gets the two points mirrored
+// across the pair, part2_fn gets every lattice point on the line through both antennae.
+void for_each_pair_antinode(Vec2 bounds, Vec2 antenna1, Vec2 antenna2, auto &&part1_fn, auto &&part2_fn)
+{
+    int64_t dx = antenna2.x - antenna1.x;
+    int64_t dy = antenna2.y - antenna1.y;
+
+    // Two antennae on the same spot don't span a line
+    if ( dx == 0 && dy == 0 ) {
+        return;
+    }
+
+    auto insideBounds = [bounds] (Vec2 v) -> bool {
+        return v.x >= 0 && v.x < bounds.x
+            && v.y >= 0 && v.y < bounds.y;
+    };
+
+    Vec2 antinodeForward = {antenna2.x + dx, antenna2.y + dy};
+    Vec2 antinodeBackward = {antenna1.x - dx, antenna1.y - dy};
+
+    if ( insideBounds(antinodeForward) ) {
+        part1_fn(antinodeForward);
+    }
+
+    if ( insideBounds(antinodeBackward) ) {
+        part1_fn(antinodeBackward);
+    }
+
+    // Smallest lattice step along the line, so points between antennae are hit as well
+    const int64_t divisor = std::gcd(dx, dy);
+    const Vec2 step = {dx / divisor, dy / divisor};
+
+    for ( Vec2 ray = antenna1; insideBounds(ray); ray = {ray.x - step.x, ray.y - step.y} ) {
+        part2_fn(ray);
+    }
+
+    for ( Vec2 ray = {antenna1.x + step.x, antenna1.y + step.y}; insideBounds(ray); ray = {ray.x + step.x, ray.y + step.y} ) {
+        part2_fn(ray);
+    }
+}
+
 struct AntennaMap {
     Vec2 bounds;
     std::unordered_map<char, std::vector<Vec2>> antennae;
-    std::unordered_set<Vec2, Vec2_hash<Vec2>> antinodes;
+
+    // Number of antenna pairs producing an antinode in each cell, per part, kept up to date
+    // by add_antenna/remove_antenna. Built lazily on the first incremental update.
+    std::array<std::vector<uint32_t>, 2> antinode_refs;
+    std::array<std::size_t, 2> distinct_antinodes{};
+
+    std::size_t cell_index(Vec2 v) const {
+        return static_cast<std::size_t>(v.y * bounds.x + v.x);
+    }
+
+    void update_pair_refs(Vec2 antenna1, Vec2 antenna2, bool adding) {
+        auto update = [this, adding] (Part part, Vec2 v) {
+            auto &refs = antinode_refs[part][cell_index(v)];
+
+            if ( adding ) {
+                if ( refs++ == 0 ) distinct_antinodes[part]++;
+            } else {
+                assert(refs > 0 && "Removing an antinode that was never added");
+                if ( --refs == 0 ) distinct_antinodes[part]--;
+            }
+        };
+
+        for_each_pair_antinode(bounds, antenna1, antenna2,
+                [&update] (Vec2 v) { update(PART1, v); },
+                [&update] (Vec2 v) { update(PART2, v); });
+    }
+
+    void rebuild_antinode_refs() {
+        for ( auto &refs : antinode_refs ) {
+            refs.assign(static_cast<std::size_t>(bounds.x * bounds.y), 0);
+        }
+        distinct_antinodes = {};
+
+        for ( auto &[freq, group] : antennae ) {
+            for ( std::size_t i = 1; i < group.size(); i++ ) {
+                for ( std::size_t j = 0; j < i; j++ ) {
+                    update_pair_refs(group[i], group[j], true);
+                }
+            }
+        }
+    }
+
+    void add_antenna(char frequency, Vec2 pos) {
+        assert(pos.x >= 0 && pos.x < bounds.x && pos.y >= 0 && pos.y < bounds.y && "Antenna outside map");
+
+        if ( antinode_refs[PART1].empty() ) {
+            rebuild_antinode_refs();
+        }
+
+        auto &group = antennae[frequency];
+
+        for ( auto other : group ) {
+            update_pair_refs(pos, other, true);
+        }
+
+        group.emplace_back(pos);
+    }
+
+    ///! Returns false if there is no such antenna
+    bool remove_antenna(char frequency, Vec2 pos) {
+        auto group_it = antennae.find(frequency);
+
+        if ( group_it == std::end(antennae) ) {
+            return false;
+        }
+
+        auto &group = group_it->second;
+        auto pos_it = std::find(std::begin(group), std::end(group), pos);
+
+        if ( pos_it == std::end(group) ) {
+            return false;
+        }
+
+        if ( antinode_refs[PART1].empty() ) {
+            rebuild_antinode_refs();
+        }
+
+        // Order within a frequency doesn't matter
+        *pos_it = group.back();
+        group.pop_back();
+
+        for ( auto other : group ) {
+            update_pair_refs(pos, other, false);
+        }
+
+        return true;
+    }
+
+    std::size_t antinode_count(Part part) {
+        if ( antinode_refs[PART1].empty() ) {
+            rebuild_antinode_refs();
+        }
+
+        return distinct_antinodes[part];
+    }
+};
+
+// Dense one-bit-per-cell antinode set, cheap to merge across threads
+struct AntinodeBitmap {
+    Vec2 bounds;
+    std::vector<uint64_t> words;
+
+    explicit AntinodeBitmap(Vec2 bounds_)
+        : bounds{bounds_}, words((static_cast<std::size_t>(bounds_.x * bounds_.y) + 63) / 64, 0)
+    { }
+
+    void insert(Vec2 v) {
+        const auto idx = static_cast<std::size_t>(v.y * bounds.x + v.x);
+        words[idx / 64] |= uint64_t{1} << (idx % 64);
+    }
+
+    bool contains(Vec2 v) const {
+        const auto idx = static_cast<std::size_t>(v.y * bounds.x + v.x);
+        return (words[idx / 64] >> (idx % 64)) & 1;
+    }
+
+    AntinodeBitmap &operator|=(const AntinodeBitmap &other) {
+        assert(words.size() == other.words.size() && "Merging bitmaps of different bounds");
+        std::transform(std::execution::unseq, std::begin(words), std::end(words),
+                std::begin(other.words), std::begin(words), std::bit_or<>{});
+        return *this;
+    }
+
+    std::size_t size() const {
+        return std::transform_reduce(std::execution::unseq, std::begin(words), std::end(words),
+                std::size_t{0}, std::plus<>{}, [] (uint64_t w) {
+                    return static_cast<std::size_t>(std::popcount(w));
+                });
+    }
+};
+
+// Part 1 and part 2 antinodes, filled by the same pair enumeration
+struct DualAntinodes {
+    AntinodeBitmap part1;
+    AntinodeBitmap part2;
+
+    explicit DualAntinodes(Vec2 bounds)
+        : part1{bounds}, part2{bounds}
+    { }
+
+    DualAntinodes &operator|=(const DualAntinodes &other) {
+        part1 |= other.part1;
+        part2 |= other.part2;
+        return *this;
+    }
 };
 
-AntennaMap read_antennae(std::ifstream &fh)
+AntennaMap read_antennae(const aoc::InputBuffer &input)
 {
 
     AntennaMap result{};
@@ -65,9 +248,7 @@ AntennaMap read_antennae(std::ifstream &fh)
 
     int64_t y = 0;
 
-    std::string current_line;
-
-    while ( std::getline(fh, current_line) ) {
+    for ( auto current_line : aoc::lines(input.view()) ) {
         int64_t current_y = y++;
 
         for ( std::size_t x = 0; x < current_line.size(); x++ ) {
@@ -85,65 +266,97 @@ AntennaMap read_antennae(std::ifstream &fh)
     return result;
 }
 
-void insert_antinodes(AntennaMap &map, std::vector<Vec2> &antennae, auto &antinodes) {
+void insert_antinodes(const AntennaMap &map, const std::vector<Vec2> &antennae, DualAntinodes &antinodes,
+        std::size_t i_begin = 1, std::size_t i_end = std::numeric_limits<std::size_t>::max()) {
+
+    i_end = std::min(i_end, antennae.size());
 
-    for ( std::size_t i = 1; i < antennae.size(); i++ ) {
+    for ( std::size_t i = std::max(i_begin, std::size_t{1}); i < i_end; i++ ) {
         for ( std::size_t j = 0; j < i; j++ ) {
+            for_each_pair_antinode(map.bounds, antennae[i], antennae[j],
+                    [&antinodes] (Vec2 v) { antinodes.part1.insert(v); },
+                    [&antinodes] (Vec2 v) { antinodes.part2.insert(v); });
+        }
+    }
+}
+
+DualAntinodes insert_all_antinodes(const AntennaMap &map)
+{
+    DualAntinodes antinodes{map.bounds};
 
-            Vec2 antenna1 = antennae[i];
-            Vec2 antenna2 = antennae[j];
+    for ( auto &pair : map.antennae ) {
+        // For all pairs
+        insert_antinodes(map, pair.second, antinodes);
+    }
 
+    return antinodes;
+}
 
-            int64_t dx = antenna2.x - antenna1.x;
-            int64_t dy = antenna2.y - antenna1.y;
+// Rows [i_begin, i_end) of the pair triangle of one frequency
+struct PairTile {
+    const std::vector<Vec2> *antennae;
+    std::size_t i_begin;
+    std::size_t i_end;
+};
 
-            auto insideBounds = [&map] (Vec2 v) -> bool {
-                return v.x >= 0 && v.x < map.bounds.x
-                    && v.y >= 0 && v.y < map.bounds.y;
-            };
+// Split all antenna pairs into one batch of tiles per worker, each holding roughly the same
+// number of pairs. Large frequencies get split across several workers.
+std::vector<std::vector<PairTile>> make_pair_tiles(const AntennaMap &map, std::size_t n_workers)
+{
+    std::size_t total_pairs = 0;
+    for ( auto &[freq, antennae] : map.antennae ) {
+        total_pairs += antennae.size() * (antennae.size() - 1) / 2;
+    }
 
-            Vec2 antinodeForward = {
-                static_cast<int64_t>(antenna2.x + dx),
-                static_cast<int64_t>(antenna2.y + dy),
-            };
+    const std::size_t pairs_per_worker = std::max<std::size_t>(1, (total_pairs + n_workers - 1) / n_workers);
 
-            Vec2 antinodeBackward = {
-                static_cast<int64_t>(antenna1.x - dx),
-                static_cast<int64_t>(antenna1.y - dy),
-            };
+    std::vector<std::vector<PairTile>> workers(1);
+    std::size_t worker_pairs = 0;
 
-            if constexpr ( PART2 ) {
-                antinodes.insert(antenna1);
-                antinodes.insert(antenna2);
+    for ( auto &[freq, antennae] : map.antennae ) {
+        std::size_t tile_begin = 1;
 
-                while ( insideBounds(antinodeForward) ) {
-                    antinodes.insert(antinodeForward);
-                    antinodeForward.x += dx;
-                    antinodeForward.y += dy;
-                }
-            } else if ( insideBounds(antinodeForward) ) {
-                antinodes.insert(antinodeForward);
-            }
+        for ( std::size_t i = 1; i < antennae.size(); i++ ) {
+            // Row i pairs antenna i with all j < i
+            worker_pairs += i;
 
-            if constexpr ( PART2 ) {
-                while ( insideBounds(antinodeBackward) ) {
-                    antinodes.insert(antinodeBackward);
-                    antinodeBackward.x -= dx;
-                    antinodeBackward.y -= dy;
-                }
-            } else if ( insideBounds(antinodeBackward) ) {
-                antinodes.insert(antinodeBackward);
+            if ( worker_pairs >= pairs_per_worker ) {
+                workers.back().emplace_back(PairTile{&antennae, tile_begin, i + 1});
+                workers.emplace_back();
+                tile_begin = i + 1;
+                worker_pairs = 0;
             }
         }
+
+        if ( tile_begin < antennae.size() ) {
+            workers.back().emplace_back(PairTile{&antennae, tile_begin, antennae.size()});
+        }
     }
+
+    return workers;
 }
 
-void insert_all_antinodes(AntennaMap &map)
+// Every worker fills its own bitmap, the bitmaps are OR-ed together at the end
+DualAntinodes insert_all_antinodes_parallel(const AntennaMap &map)
 {
-    for ( auto pair : map.antennae ) {
-        // For all pairs
-        insert_antinodes(map, pair.second, map.antinodes);
-    }
+    const std::size_t n_workers = std::max(1u, std::thread::hardware_concurrency());
+    auto workers = make_pair_tiles(map, n_workers);
+
+    return std::transform_reduce(std::execution::par, std::begin(workers), std::end(workers),
+            DualAntinodes{map.bounds},
+            [] (DualAntinodes lhs, const DualAntinodes &rhs) {
+                lhs |= rhs;
+                return lhs;
+            },
+            [&map] (const std::vector<PairTile> &tiles) {
+                DualAntinodes local{map.bounds};
+
+                for ( auto &tile : tiles ) {
+                    insert_antinodes(map, *tile.antennae, local, tile.i_begin, tile.i_end);
+                }
+
+                return local;
+            });
 }
 
 char antenna_at(const AntennaMap &map, Vec2 coord)
@@ -158,7 +371,7 @@ char antenna_at(const AntennaMap &map, Vec2 coord)
     return repr;
 }
 
-void print_map(const AntennaMap &map) {
+void print_map(const AntennaMap &map, const AntinodeBitmap &antinodes) {
     for ( int64_t y = 0; y < map.bounds.y; y++ ) {
         for ( int64_t x = 0; x < map.bounds.x; x++ ) {
 
@@ -167,7 +380,7 @@ void print_map(const AntennaMap &map) {
             char repr = antenna_at(map, coord);
 
 
-            if ( repr == '.' && map.antinodes.contains(coord) ) {
+            if ( repr == '.' && antinodes.contains(coord) ) {
                 repr = '#';
             }
 
@@ -178,25 +391,34 @@ void print_map(const AntennaMap &map) {
 }
 
 
-uint64_t task1(std::filesystem::path path)
+std::pair<uint64_t, uint64_t> task1(std::filesystem::path path)
 {
 
-    std::ifstream fh{path};
+    aoc::InputBuffer input{path};
 
-    if ( ! fh.is_open() ) {
+    if ( ! input.is_open() ) {
         std::cerr << std::format("Couldn't open {}!\n", path.string());
     }
 
-    auto map = read_antennae(fh);
+    auto map = read_antennae(input);
 
-    insert_all_antinodes(map);
+    auto antinodes = insert_all_antinodes_parallel(map);
 
     std::cout << std::format("Bounds {} x {}\n", map.bounds.x, map.bounds.y);
 
-    auto result = map.antinodes.size();
-    return result;
+    return std::make_pair(antinodes.part1.size(), antinodes.part2.size());
 }
 
+} // namespace day8
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1{8, "task1", [] (const std::filesystem::path &path) {
+    return aoc::answer(day8::task1(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -210,9 +432,12 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
+    auto [t1, t2] = day8::task1(file_to_read);
 
-    std::cout << std::format("Result: {}\n", t1);
+    std::cout << std::format("Task 1: {}\n", t1);
+    std::cout << std::format("Task 2: {}\n", t2);
 
     return 0;
 }
+
+#endif
@@ -1,315 +1,391 @@
+#include <algorithm>
 #include <cassert>
 #include <execution>
 #include <cmath>
 #include <cstdlib>
-#include <deque>
-#include <fstream>
 #include <iostream>
 #include <filesystem>
 #include <format>
 #include <numeric>
-#include <ranges>
+#include <optional>
+#include <queue>
+#include <string>
 #include <vector>
 
-static constexpr bool PART2 = true;
+#include "input.h"
+#include "runner.h"
 
-template <class TypeT,
-    template <class Stored, class Allocator = std::allocator<Stored>> class Container = std::vector>
-Container<TypeT> consumeStream(std::basic_istream<char> &stream)
-{
-    Container<TypeT> result{};
+namespace day9 {
 
-    TypeT current;
+// Checksums of large disks don't fit in 64 bits
+__extension__ typedef unsigned __int128 uint128_t;
 
-    while ( stream >> current ) {
-        result.emplace_back(current);
-    }
+// Flat structure-of-arrays disk layout. Compaction only rewrites offsets and lengths
+// in place, no element is ever inserted in the middle.
+struct DiskLayout {
+    std::vector<std::size_t> file_start;
+    std::vector<std::size_t> file_length;
+    std::vector<int64_t> file_ID;
 
-    return result;
-}
+    std::vector<std::size_t> gap_start;
+    std::vector<std::size_t> gap_length;
 
-enum class BlockType {
-    FREE,
-    FILE,
-    INVALID
-};
+    void add_file(std::size_t start, std::size_t length, int64_t ID) {
+        file_start.push_back(start);
+        file_length.push_back(length);
+        file_ID.push_back(ID);
+    }
+
+    void add_gap(std::size_t start, std::size_t length) {
+        gap_start.push_back(start);
+        gap_length.push_back(length);
+    }
 
-struct Block {
-    BlockType type;
-    std::size_t length;
-    int64_t ID;
+    void print() const {
+        std::size_t end = 0;
+        for ( std::size_t f = 0; f < file_start.size(); f++ ) {
+            end = std::max(end, file_start[f] + file_length[f]);
+        }
 
-    explicit Block(BlockType type_, std::size_t length_, int64_t ID_)
-        : type{type_}, length{length_}, ID{ID_}
-    { }
+        std::vector<int64_t> units(end, -1);
+        for ( std::size_t f = 0; f < file_start.size(); f++ ) {
+            std::fill_n(std::begin(units) + static_cast<std::ptrdiff_t>(file_start[f]), file_length[f], file_ID[f]);
+        }
 
-    void print() {
-        if ( type == BlockType::FILE ) {
-            for ( std::size_t i = 0; i < length; i++ ) {
-                std::cout << ID;
-            }
-        } else {
-            for ( std::size_t i = 0; i < length; i++ ) {
-                std::cout << '.';
-            }
+        for ( auto ID : units ) {
+            std::cout << ( ID < 0 ? std::string{"."} : std::to_string(ID) );
         }
+
+        std::cout << "\n";
     }
 };
 
+// Moves file units from the back into the gaps at the front. Gaps are walked forward
+// and files backward, so this is a single linear pass. A file split over several gaps
+// keeps its unmoved head in place, the moved pieces are appended as new fragments.
+DiskLayout compact(DiskLayout layout)
+{
+    const std::size_t n_files = layout.file_start.size();
+    const std::size_t n_gaps = layout.gap_start.size();
 
-auto print_blocks(std::deque<Block> &blocks) {
+    std::size_t g = 0;
+    std::size_t f = n_files;
 
-    for ( auto &b : blocks ) {
-        std::string repr = std::to_string(b.ID);
+    while ( f > 0 && g < n_gaps ) {
+        const std::size_t file = f - 1;
 
-        if ( b.type == BlockType::FREE ) {
-            repr = std::format("[{}]", b.length);
-            std::cout << repr;
+        if ( layout.file_length[file] == 0 ) {
+            f--;
             continue;
         }
 
-        for ( [[maybe_unused]] auto i : std::ranges::views::iota(0uLL, b.length) ) {
-            std::cout << repr;
+        if ( layout.gap_length[g] == 0 ) {
+            g++;
+            continue;
         }
-    }
 
-    std::cout << "\n";
-
-}
+        // Every remaining gap is right of the file
+        if ( layout.gap_start[g] >= layout.file_start[file] ) {
+            break;
+        }
 
-bool is_compacted(std::deque<Block> &blocks)
-{
-    auto firstFree = std::find_if(std::begin(blocks), std::end(blocks), [] (Block b){
-        return b.type == BlockType::FREE;
-    });
+        const std::size_t moved = std::min(layout.gap_length[g], layout.file_length[file]);
 
-    auto fileAfterFree = std::find_if(firstFree, std::end(blocks), [] (Block b) {
-        return b.type == BlockType::FILE;
-    });
+        if ( moved == layout.file_length[file] ) {
+            layout.file_start[file] = layout.gap_start[g];
+            f--;
+        } else {
+            layout.file_length[file] -= moved;
+            layout.add_file(layout.gap_start[g], moved, layout.file_ID[file]);
+        }
 
-    if ( fileAfterFree != std::end(blocks) ) {
-        return false;
+        layout.gap_start[g] += moved;
+        layout.gap_length[g] -= moved;
     }
 
-    return true;
+    return layout;
 }
 
-std::deque<Block> compact(std::deque<Block> &blocks)
-{
-    std::deque<Block> compacted = blocks;
-
+// Free spans bucketed by length, each bucket a min-heap of (start offset, gap index).
+// Finding the leftmost span that fits n units only looks at the tops of buckets >= n.
+struct FreeSpanIndex {
+    using Span = std::pair<std::size_t, std::size_t>;
+    using MinHeap = std::priority_queue<Span, std::vector<Span>, std::greater<>>;
 
-    std::size_t iter_limit = 5000;
+    std::vector<MinHeap> by_length;
 
-    while ( ! is_compacted(compacted) && iter_limit-- ) {
-
-        // Backmost file
-        auto backmost_file_iter = std::find_if(std::rbegin(compacted), std::rend(compacted), [] (Block &b) {
-            return b.type == BlockType::FILE;
-        });
-
-        Block &back = *backmost_file_iter;
-        Block copy = back;
+    explicit FreeSpanIndex(const DiskLayout &layout) {
+        for ( std::size_t g = 0; g < layout.gap_start.size(); g++ ) {
+            insert(layout.gap_start[g], layout.gap_length[g], g);
+        }
+    }
 
-        back.type = BlockType::FREE;
-        back.ID = -1;
+    void insert(std::size_t start, std::size_t length, std::size_t gap) {
+        if ( length == 0 ) {
+            return;
+        }
 
-        std::size_t len_left = copy.length;
+        if ( length >= by_length.size() ) {
+            by_length.resize(length + 1);
+        }
 
-        auto firstFree = std::begin(compacted);
+        by_length[length].push(Span{start, gap});
+    }
 
+    ///! Takes `length` units from the leftmost gap that fits and starts before `limit`,
+    ///! shrinking that gap in the layout
+    std::optional<std::size_t> take_leftmost(DiskLayout &layout, std::size_t length, std::size_t limit) {
+        std::size_t best_length = 0;
+        std::size_t best_start = limit;
 
-        while ( len_left > 0 ) {
-            firstFree = std::find_if(firstFree, std::end(compacted), [] (Block &b) {
-                return b.type == BlockType::FREE;
-            });
+        for ( std::size_t l = length; l < by_length.size(); l++ ) {
+            if ( ! by_length[l].empty() && by_length[l].top().first < best_start ) {
+                best_start = by_length[l].top().first;
+                best_length = l;
+            }
+        }
 
-            Block &to_alloc = *firstFree;
+        if ( best_length == 0 ) {
+            return std::nullopt;
+        }
 
-            const std::size_t target_block_size = to_alloc.length;
-            const std::size_t moved_block_size = len_left;
+        const std::size_t gap = by_length[best_length].top().second;
+        by_length[best_length].pop();
 
-            const std::size_t len_to_alloc = std::min(moved_block_size, target_block_size);
-            const std::size_t new_len_left = moved_block_size - len_to_alloc;
-            const std::size_t remaining_free_space = target_block_size - moved_block_size;
+        layout.gap_start[gap] += length;
+        layout.gap_length[gap] -= length;
+        insert(layout.gap_start[gap], layout.gap_length[gap], gap);
 
-            to_alloc.type = BlockType::FILE;
-            to_alloc.ID = copy.ID;
-            to_alloc.length = len_to_alloc;
+        return best_start;
+    }
+};
 
-            if ( target_block_size > moved_block_size ) {
-                // Insert block after
-                Block newFreeBlock = Block{BlockType::FREE, remaining_free_space, -1};
-                compacted.insert(std::next(firstFree), newFreeBlock);
+DiskLayout compact_fit(DiskLayout layout)
+{
+    FreeSpanIndex free_spans{layout};
 
+    // File IDs follow disk order, so walking the arrays backwards is descending ID order.
+    // Space freed by a moved file lies right of every file with a lower ID, so it can
+    // never be used again and isn't put back into the index.
+    for ( std::size_t f = layout.file_start.size(); f-- > 0; ) {
+        if ( layout.file_length[f] == 0 ) {
+            continue;
+        }
 
-            }
-            len_left = new_len_left;
+        if ( auto start = free_spans.take_leftmost(layout, layout.file_length[f], layout.file_start[f]) ) {
+            layout.file_start[f] = *start;
         }
     }
 
-    return compacted;
+    return layout;
 }
 
-
-auto find_first_free_slot(std::deque<Block> &blocks, std::size_t req_size = 1)
+// Sum of (start + i) * ID over the file's units, i in [0, length)
+constexpr uint128_t file_checksum(std::size_t start, std::size_t length, int64_t ID)
 {
-    return std::find_if(
-        std::begin(blocks),
-        std::end(blocks),
-        [req_size] (Block &b) -> bool {
-            bool isFile = b.type == BlockType::FREE;
-            bool hasSpace = b.length >= req_size;
-            return isFile && hasSpace;
-        });
+    const uint128_t len = length;
+    return static_cast<uint128_t>(ID) * (len * start + len * (len - 1) / 2);
 }
 
-
-std::deque<Block> combine_empty_blocks(std::deque<Block> &&blocks)
+uint128_t blocks_checksum(const DiskLayout &layout)
 {
-    std::deque<Block> compacted{};
+    // Chunks are summed in parallel, each chunk is a branch-free loop over the arrays
+    static constexpr std::size_t CHUNK_SIZE = std::size_t{1} << 16;
 
-    const auto N = blocks.size();
+    const std::size_t n_files = layout.file_start.size();
 
-    for ( std::size_t i = 0; i < N; ) {
+    std::vector<std::size_t> chunk_begins{};
+    for ( std::size_t begin = 0; begin < n_files; begin += CHUNK_SIZE ) {
+        chunk_begins.push_back(begin);
+    }
 
-        if ( blocks[i].type == BlockType::FREE ) {
-            std::size_t j = i;
+    return std::transform_reduce(std::execution::par, std::begin(chunk_begins), std::end(chunk_begins),
+            uint128_t{0}, std::plus<>{}, [&layout, n_files] (std::size_t begin) {
+                const std::size_t end = std::min(begin + CHUNK_SIZE, n_files);
 
-            std::size_t accumulated_free_space = 0;
-            while ( j < N && blocks[j].type == BlockType::FREE ) {
-                accumulated_free_space += blocks[j++].length;
-            }
+                const std::size_t *starts = layout.file_start.data();
+                const std::size_t *lengths = layout.file_length.data();
+                const int64_t *IDs = layout.file_ID.data();
 
-            compacted.emplace_back(Block{BlockType::FREE, accumulated_free_space, -1});
+                uint128_t partial = 0;
 
-            i = j;
-        } else {
-            compacted.push_back(blocks[i++]);
-        }
-    }
+                for ( std::size_t f = begin; f < end; f++ ) {
+                    partial += file_checksum(starts[f], lengths[f], IDs[f]);
+                }
 
-    return compacted;
+                return partial;
+            });
 }
 
-std::deque<Block> compact_fit(std::deque<Block> &blocks)
+std::string to_string(uint128_t value)
 {
-    std::deque<Block> compacted = blocks;
-
-    auto file_iter = std::rbegin(compacted);
-    std::size_t iter_limit = 200;
+    std::string digits{};
 
-    while ( file_iter != std::rend(compacted) && iter_limit ) {
-        file_iter = std::find_if(file_iter, std::rend(compacted), [] (Block &b) {
-            return b.type == BlockType::FILE;
-        });
+    do {
+        digits.push_back(static_cast<char>('0' + static_cast<int>(value % 10)));
+        value /= 10;
+    } while ( value > 0 );
 
-        Block &candidateFile = *file_iter;
+    return {std::rbegin(digits), std::rend(digits)};
+}
 
-        // Find first available slot
-        auto free_slot_iter = find_first_free_slot(compacted, candidateFile.length);
+DiskLayout read_layout(std::filesystem::path path)
+{
+    aoc::InputBuffer input{path};
 
-        // Check if this spot is past the file
-        auto forward_file_iter = (file_iter + 1).base();
-        if ( std::distance(forward_file_iter, free_slot_iter) > 0 ) {
-            // Past the file, cannot be moved
-            file_iter = std::next(file_iter);
-            continue;
-        }
+    if ( ! input.is_open() ) {
+        std::cerr << std::format("Couldn't open {}!\n", path.string());
+    }
 
-        // Can be moved
-        Block copy = candidateFile;
+    bool currentType = true;
 
-        candidateFile.ID = -1;
-        candidateFile.type = BlockType::FREE;
+    DiskLayout layout{};
 
-        // Move block into free space
-        std::size_t remaining_free_space = (*free_slot_iter).length - candidateFile.length;
+    std::size_t pos = 0;
+    int64_t currentID = 0;
+    for ( char c : input.view() ) {
+        if ( aoc::is_blank(c) ) {
+            continue;
+        }
 
-        *free_slot_iter = copy;
-        if ( remaining_free_space > 0 ) {
-            compacted.insert(std::next(free_slot_iter), Block{BlockType::FREE, remaining_free_space, -1});
+        // Assumes all input characters are between 0-9
 
-            file_iter = std::find_if(std::rbegin(compacted), std::rend(compacted), [&copy] (Block &b) {
-                return b.ID == copy.ID - 1;
-            });
+        if ( c < '0' || c > '9' ) {
+            std::cerr << "Got invalid input\n";
+            std::abort();
         }
-    }
-
 
-    return combine_empty_blocks(std::move(compacted));}
+        std::size_t len = static_cast<std::size_t>(c - '0');
 
-std::size_t blocks_checksum(std::deque<Block> &blocks)
-{
-    std::size_t total = 0;
-    std::size_t pos = 0;
-    for ( auto &b : blocks ) {
-        if ( b.type == BlockType::FILE ) {
-            std::size_t offset = 0;
-            while (  offset < b.length ) {
-                total += (pos + offset) * static_cast<std::size_t>(b.ID);
-                offset++;
-            }
+        if ( currentType ) {
+            layout.add_file(pos, len, currentID++);
+        } else {
+            layout.add_gap(pos, len);
         }
 
-        pos += b.length;
+        pos += len;
+        currentType = !currentType;
     }
 
-    return total;
+    return layout;
 }
 
+// Part 1 on the block layout, task1_streaming gets the same answer without one
+uint128_t task1(std::filesystem::path path)
+{
+    return blocks_checksum(compact(read_layout(path)));
+}
 
-
-uint64_t task1(std::filesystem::path path)
+uint128_t task2(std::filesystem::path path)
 {
+    return blocks_checksum(compact_fit(read_layout(path)));
+}
 
-    std::ifstream fh{path};
+// Part 1 straight off the mapped disk map: gaps are read from the front, files from
+// the back, and every placed piece is added to the checksum right away. No blocks
+// are materialized, so memory use is constant beyond the mapping.
+uint128_t task1_streaming(std::filesystem::path path)
+{
+    // Read from both ends at once, sequential readahead would only serve the front
+    aoc::InputBuffer file{path, MADV_NORMAL};
 
-    if ( ! fh.is_open() ) {
+    if ( ! file.is_open() ) {
         std::cerr << std::format("Couldn't open {}!\n", path.string());
     }
 
-    char c;
+    const char *digits = file.view().data();
+    std::size_t n = file.view().size();
 
-    bool currentType = true;
+    // Trailing newline
+    while ( n > 0 && ( digits[n - 1] < '0' || digits[n - 1] > '9' ) ) {
+        n--;
+    }
 
-    std::deque<Block> blocks{};
+    if ( n == 0 ) {
+        return 0;
+    }
 
-    int64_t currentID = 0;
-    while ( fh >> c ) {
-        // Assumes all input characters are between 0-9
+    auto length_at = [digits] (std::size_t idx) -> std::size_t {
+        char c = digits[idx];
 
         if ( c < '0' || c > '9' ) {
             std::cerr << "Got invalid input\n";
             std::abort();
         }
 
-        std::size_t len = static_cast<std::size_t>(c - '0');
+        return static_cast<std::size_t>(c - '0');
+    };
 
-        BlockType selectedBlockType = currentType ? BlockType::FILE : BlockType::FREE;
-        int64_t blockID = selectedBlockType == BlockType::FILE ? currentID : -1;
+    // Even indices are files with ID idx / 2, odd ones are gaps
+    std::size_t front = 0;
+    std::size_t back = (n - 1) % 2 == 0 ? n - 1 : n - 2;
+    std::size_t back_left = length_at(back);
 
-        blocks.emplace_back(Block{selectedBlockType, len, blockID});
+    std::size_t pos = 0;
+    uint128_t checksum = 0;
 
-        if ( selectedBlockType == BlockType::FILE ) {
-            currentID++;
+    auto place = [&pos, &checksum] (std::size_t length, std::size_t idx) {
+        checksum += file_checksum(pos, length, static_cast<int64_t>(idx / 2));
+        pos += length;
+    };
+
+    while ( front < back ) {
+        if ( front % 2 == 0 ) {
+            place(length_at(front), front);
+            front++;
+            continue;
         }
 
-        currentType = !currentType;
-    }
+        std::size_t gap = length_at(front);
+
+        while ( gap > 0 ) {
+            if ( back_left == 0 ) {
+                back -= 2;
+
+                if ( back <= front ) {
+                    break;
+                }
 
-    decltype(compact_fit(blocks)) compacted{};
+                back_left = length_at(back);
+                continue;
+            }
+
+            const std::size_t moved = std::min(gap, back_left);
+            place(moved, back);
+
+            gap -= moved;
+            back_left -= moved;
+        }
 
-    if constexpr ( PART2 ) {
-        compacted = compact_fit(blocks);
-    } else {
-        compacted = compact(blocks);
+        front++;
+    }
+
+    // The file the two ends met at keeps whatever wasn't moved
+    if ( front == back ) {
+        place(back_left, back);
     }
 
-    auto checksum = blocks_checksum(compacted);
     return checksum;
 }
 
+} // namespace day9
+
+#ifdef AOC_RUNNER
+
+static aoc::RegisterTask register_task1_streaming{9, "task1_streaming", [] (const std::filesystem::path &path) {
+    return day9::to_string(day9::task1_streaming(path));
+}};
+
+static aoc::RegisterTask register_task1{9, "task1", [] (const std::filesystem::path &path) {
+    return day9::to_string(day9::task1(path));
+}};
+
+static aoc::RegisterTask register_task2{9, "task2", [] (const std::filesystem::path &path) {
+    return day9::to_string(day9::task2(path));
+}};
+
+#else
+
 int main(int argc, char *argv[])
 {
 
@@ -323,9 +399,14 @@ int main(int argc, char *argv[])
         std::cout << std::format("File {} does not exist\n", file_to_read.string()) << "\n";
     }
 
-    auto t1 = task1(file_to_read);
+    // Part 1 doesn't need the block layout at all
+    auto t1 = day9::task1_streaming(file_to_read);
+    auto t2 = day9::task2(file_to_read);
 
-    std::cout << std::format("Result: {}\n", t1);
+    std::cout << std::format("Task 1: {}\n", day9::to_string(t1));
+    std::cout << std::format("Task 2: {}\n", day9::to_string(t2));
 
     return 0;
 }
+
+#endif
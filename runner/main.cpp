@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "input.h"
+#include "runner.h"
+
+// Runs every registered task (or the selected days) against dayN/input and reports
+// min/median/p99 wall time per task.
+//
+//   runner [--days 1,5,12] [--warmup N] [--reps N] [--root DIR] [--input NAME] [--json]
+
+struct Options {
+    std::vector<int> days;
+    std::size_t warmup = 1;
+    std::size_t reps = 10;
+    std::filesystem::path root = ".";
+    std::string input_name = "input";
+    bool json = false;
+};
+
+struct TaskTiming {
+    const aoc::Task *task;
+    std::filesystem::path input;
+    std::string answer;
+    std::vector<double> ms;
+    bool skipped = false;
+
+    double min() const {
+        return ms.front();
+    }
+
+    double median() const {
+        std::size_t n = ms.size();
+        return n % 2 == 1 ? ms[n / 2] : (ms[n / 2 - 1] + ms[n / 2]) / 2;
+    }
+
+    // Nearest rank, with few repetitions this is just the slowest run
+    double p99() const {
+        auto rank = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(ms.size())));
+        return ms[std::max<std::size_t>(rank, 1) - 1];
+    }
+};
+
+// Swallows everything, tasks like to chat on std::cout
+struct NullBuffer : std::streambuf {
+    int overflow(int c) override {
+        return c;
+    }
+};
+
+void usage()
+{
+    std::cerr << "Usage: runner [--days 1,5,12] [--warmup N] [--reps N] [--root DIR] [--input NAME] [--json]\n";
+    std::exit(1);
+}
+
+Options parse_options(int argc, char *argv[])
+{
+    Options options{};
+
+    for ( int i = 1; i < argc; i++ ) {
+        std::string_view arg{argv[i]};
+
+        if ( arg == "--json" ) {
+            options.json = true;
+            continue;
+        }
+
+        if ( i + 1 >= argc ) {
+            usage();
+        }
+
+        std::string_view value{argv[++i]};
+
+        if ( arg == "--days" ) {
+            options.days = aoc::parse_ints<int>(value, ',');
+        } else if ( arg == "--warmup" ) {
+            options.warmup = aoc::expect_int<std::size_t>(value);
+        } else if ( arg == "--reps" ) {
+            options.reps = std::max<std::size_t>(aoc::expect_int<std::size_t>(value), 1);
+        } else if ( arg == "--root" ) {
+            options.root = value;
+        } else if ( arg == "--input" ) {
+            options.input_name = value;
+        } else {
+            usage();
+        }
+    }
+
+    return options;
+}
+
+TaskTiming run_task(const aoc::Task &task, const Options &options)
+{
+    TaskTiming timing{&task, options.root / std::format("day{}", task.day) / options.input_name, {}, {}};
+
+    if ( ! std::filesystem::exists(timing.input) ) {
+        std::cerr << std::format("Skipping day{} {}: {} does not exist\n", task.day, task.name, timing.input.string());
+        timing.skipped = true;
+        return timing;
+    }
+
+    NullBuffer null_buffer{};
+    auto *cout_buffer = std::cout.rdbuf(&null_buffer);
+
+    for ( std::size_t i = 0; i < options.warmup; i++ ) {
+        timing.answer = task.run(timing.input);
+    }
+
+    for ( std::size_t i = 0; i < options.reps; i++ ) {
+        auto start = std::chrono::steady_clock::now();
+        timing.answer = task.run(timing.input);
+        auto end = std::chrono::steady_clock::now();
+
+        timing.ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::cout.rdbuf(cout_buffer);
+
+    std::sort(std::begin(timing.ms), std::end(timing.ms));
+    return timing;
+}
+
+std::string json_escape(std::string_view text)
+{
+    std::string result{};
+
+    for ( char c : text ) {
+        if ( c == '"' || c == '\\' ) {
+            result += '\\';
+            result += c;
+        } else if ( c == '\n' ) {
+            result += "\\n";
+        } else if ( c == '\t' ) {
+            result += "\\t";
+        } else if ( c == '\r' ) {
+            result += "\\r";
+        } else if ( static_cast<unsigned char>(c) < 0x20 ) {
+            // Other control characters aren't allowed raw in a JSON string
+            result += std::format("\\u{:04x}", static_cast<unsigned>(static_cast<unsigned char>(c)));
+        } else {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+void print_table(const std::vector<TaskTiming> &timings)
+{
+    std::cout << std::format("{:<6} {:<16} {:>12} {:>12} {:>12}  {}\n", "day", "task", "min ms", "median ms", "p99 ms", "answer");
+
+    double total = 0;
+
+    for ( const auto &timing : timings ) {
+        if ( timing.skipped ) {
+            continue;
+        }
+
+        std::cout << std::format("{:<6} {:<16} {:>12.3f} {:>12.3f} {:>12.3f}  {}\n",
+                                 timing.task->day, timing.task->name, timing.min(), timing.median(), timing.p99(), timing.answer);
+        total += timing.median();
+    }
+
+    std::cout << std::format("Total of medians: {:.3f} ms\n", total);
+}
+
+void print_json(const std::vector<TaskTiming> &timings, const Options &options)
+{
+    std::cout << std::format("{{\n  \"warmup\": {},\n  \"reps\": {},\n  \"tasks\": [", options.warmup, options.reps);
+
+    bool first = true;
+
+    for ( const auto &timing : timings ) {
+        std::cout << (first ? "\n" : ",\n");
+        first = false;
+
+        std::cout << std::format("    {{\"day\": {}, \"task\": \"{}\", \"input\": \"{}\"",
+                                 timing.task->day, json_escape(timing.task->name), json_escape(timing.input.string()));
+
+        if ( timing.skipped ) {
+            std::cout << ", \"skipped\": true}";
+            continue;
+        }
+
+        std::cout << std::format(", \"answer\": \"{}\", \"min_ms\": {:.6f}, \"median_ms\": {:.6f}, \"p99_ms\": {:.6f}}}",
+                                 json_escape(timing.answer), timing.min(), timing.median(), timing.p99());
+    }
+
+    std::cout << "\n  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Options options = parse_options(argc, argv);
+
+    // Days come from separate translation units, so registration order across days is arbitrary
+    std::vector<const aoc::Task *> tasks{};
+    for ( const auto &task : aoc::task_registry() ) {
+        if ( options.days.empty() || std::ranges::find(options.days, task.day) != std::end(options.days) ) {
+            tasks.push_back(&task);
+        }
+    }
+
+    std::ranges::stable_sort(tasks, {}, &aoc::Task::day);
+
+    if ( tasks.empty() ) {
+        std::cerr << "No tasks selected\n";
+        return 1;
+    }
+
+    std::vector<TaskTiming> timings{};
+    for ( const auto *task : tasks ) {
+        timings.push_back(run_task(*task, options));
+    }
+
+    if ( options.json ) {
+        print_json(timings, options);
+    } else {
+        print_table(timings);
+    }
+
+    return 0;
+}